@@ -0,0 +1,205 @@
+#ifndef CELL_DEPLOYMENT_H
+#define CELL_DEPLOYMENT_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== CELL SITES ====================
+// One base-station site, in the same projected metres as the SUMO network
+// (and therefore the ns-2 mobility traces exported from it).
+struct CellSite {
+  double x;
+  double y;
+  double z;
+  std::string name;
+};
+
+// Reads "x y [z [name]]" lines; '#' starts a comment. Height defaults to 30 m.
+inline std::vector<CellSite> LoadCellSites(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    NS_FATAL_ERROR("Cannot open cell site file " << path);
+  }
+  std::vector<CellSite> sites;
+  std::string line;
+  uint32_t lineNo = 0;
+  while (std::getline(in, line)) {
+    lineNo++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    CellSite site;
+    if (!(fields >> site.x)) {
+      continue;  // blank or comment-only line
+    }
+    if (!(fields >> site.y)) {
+      NS_FATAL_ERROR(path << ":" << lineNo << ": expected \"x y [z [name]]\"");
+    }
+    if (!(fields >> site.z)) {
+      site.z = 30.0;
+    }
+    if (!(fields >> site.name)) {
+      site.name = "site" + std::to_string(sites.size());
+    }
+    sites.push_back(site);
+  }
+  if (sites.empty()) {
+    NS_FATAL_ERROR("No cell sites in " << path);
+  }
+  return sites;
+}
+
+// Reorders sites so that every prefix is spread over the whole area: first
+// the site closest to the centroid, then repeatedly the one furthest from
+// those already taken. Using the first k sites then gives a sparser but
+// still even deployment, which is what a gateway density sweep needs.
+inline std::vector<CellSite> SpreadSites(const std::vector<CellSite> &sites) {
+  double cx = 0, cy = 0;
+  for (const CellSite &s : sites) {
+    cx += s.x / sites.size();
+    cy += s.y / sites.size();
+  }
+  std::vector<double> dist(sites.size(), std::numeric_limits<double>::infinity());
+  std::vector<bool> taken(sites.size(), false);
+  std::vector<CellSite> order;
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < sites.size(); ++i) {
+    double d = (sites[i].x - cx) * (sites[i].x - cx) + (sites[i].y - cy) * (sites[i].y - cy);
+    double best = (sites[next].x - cx) * (sites[next].x - cx) + (sites[next].y - cy) * (sites[next].y - cy);
+    if (d < best) {
+      next = i;
+    }
+  }
+  while (order.size() < sites.size()) {
+    taken[next] = true;
+    order.push_back(sites[next]);
+    double furthest = -1;
+    for (uint32_t i = 0; i < sites.size(); ++i) {
+      double dx = sites[i].x - sites[next].x;
+      double dy = sites[i].y - sites[next].y;
+      dist[i] = std::min(dist[i], dx * dx + dy * dy);
+    }
+    for (uint32_t i = 0; i < sites.size(); ++i) {
+      if (!taken[i] && dist[i] > furthest) {
+        furthest = dist[i];
+        next = i;
+      }
+    }
+  }
+  return order;
+}
+
+// ==================== SPATIAL INDEX ====================
+// Uniform grid over the sites' bounding box, about one site per bucket.
+// Nearest-site queries search outward ring by ring and stop once no unseen
+// bucket can hold anything closer, so attaching N UEs costs O(N) instead of
+// O(N x sites).
+class CellGridIndex {
+public:
+  explicit CellGridIndex(const std::vector<CellSite> &sites) : m_sites(sites) {
+    m_minX = m_maxX = sites[0].x;
+    m_minY = m_maxY = sites[0].y;
+    for (const CellSite &s : sites) {
+      m_minX = std::min(m_minX, s.x);
+      m_maxX = std::max(m_maxX, s.x);
+      m_minY = std::min(m_minY, s.y);
+      m_maxY = std::max(m_maxY, s.y);
+    }
+    double area = std::max((m_maxX - m_minX) * (m_maxY - m_minY), 1.0);
+    m_cellSize = std::max(std::sqrt(area / sites.size()), 1.0);
+    m_cols = static_cast<int>((m_maxX - m_minX) / m_cellSize) + 1;
+    m_rows = static_cast<int>((m_maxY - m_minY) / m_cellSize) + 1;
+    m_buckets.resize(m_cols * m_rows);
+    for (uint32_t i = 0; i < sites.size(); ++i) {
+      m_buckets[Bucket(Col(sites[i].x), Row(sites[i].y))].push_back(i);
+    }
+  }
+
+  // Index of the site closest to (x, y) in the horizontal plane.
+  uint32_t Nearest(double x, double y) const {
+    int col = std::min(std::max(Col(x), 0), m_cols - 1);
+    int row = std::min(std::max(Row(y), 0), m_rows - 1);
+    uint32_t best = 0;
+    double bestDist = std::numeric_limits<double>::infinity();
+    // A point outside the bounding box is at least this far from every site
+    double outside = std::max({m_minX - x, x - m_maxX, m_minY - y, y - m_maxY, 0.0});
+    int maxRing = std::max(m_cols, m_rows);
+    for (int ring = 0; ring <= maxRing; ++ring) {
+      // Anything in this ring or beyond is at least (ring - 1) buckets away
+      double ringDist = std::max(ring - 1, 0) * m_cellSize;
+      if (outside * outside + ringDist * ringDist > bestDist) {
+        break;
+      }
+      for (int r = row - ring; r <= row + ring; ++r) {
+        for (int c = col - ring; c <= col + ring; ++c) {
+          if (r < 0 || c < 0 || r >= m_rows || c >= m_cols
+              || (std::abs(r - row) != ring && std::abs(c - col) != ring)) {
+            continue;
+          }
+          for (uint32_t i : m_buckets[Bucket(c, r)]) {
+            double dx = m_sites[i].x - x;
+            double dy = m_sites[i].y - y;
+            double d = dx * dx + dy * dy;
+            if (d < bestDist) {
+              bestDist = d;
+              best = i;
+            }
+          }
+        }
+      }
+    }
+    return best;
+  }
+
+  double GetMinX() const { return m_minX; }
+  double GetMaxX() const { return m_maxX; }
+  double GetMinY() const { return m_minY; }
+  double GetMaxY() const { return m_maxY; }
+
+private:
+  int Col(double x) const { return static_cast<int>(std::floor((x - m_minX) / m_cellSize)); }
+  int Row(double y) const { return static_cast<int>(std::floor((y - m_minY) / m_cellSize)); }
+  int Bucket(int col, int row) const { return row * m_cols + col; }
+
+  std::vector<CellSite> m_sites;
+  std::vector<std::vector<uint32_t>> m_buckets;
+  double m_minX, m_maxX, m_minY, m_maxY;
+  double m_cellSize;
+  int m_cols, m_rows;
+};
+
+// ==================== LOAD BALANCE ====================
+struct CellLoadSummary {
+  uint32_t minLoad;
+  uint32_t maxLoad;
+  double meanLoad;
+  double jainIndex;  // 1 = perfectly even, 1/cells = everything on one cell
+  uint32_t idleCells;
+};
+
+inline CellLoadSummary SummariseCellLoad(const std::vector<uint32_t> &load) {
+  CellLoadSummary summary = {std::numeric_limits<uint32_t>::max(), 0, 0.0, 0.0, 0};
+  double sum = 0, sumSq = 0;
+  for (uint32_t l : load) {
+    summary.minLoad = std::min(summary.minLoad, l);
+    summary.maxLoad = std::max(summary.maxLoad, l);
+    summary.idleCells += l == 0;
+    sum += l;
+    sumSq += static_cast<double>(l) * l;
+  }
+  summary.meanLoad = load.empty() ? 0.0 : sum / load.size();
+  summary.jainIndex = sumSq > 0 ? sum * sum / (load.size() * sumSq) : 1.0;
+  return summary;
+}
+
+} // namespace ns3
+
+#endif /* CELL_DEPLOYMENT_H */
@@ -0,0 +1,111 @@
+#ifndef CULLED_LORA_CHANNEL_H
+#define CULLED_LORA_CHANNEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/lora-channel.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/lora-phy.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "range_culling.h"
+
+#include <tuple>
+
+namespace ns3 {
+
+// ==================== RANGE-CULLED LORA CHANNEL ====================
+// LoraChannel that only delivers a transmission to PHYs within its useful
+// range, i.e. where the loss model leaves it above RxThresholdDbm; the rest
+// are never evaluated or scheduled. Delivery to the receivers it does reach
+// is the same as LoraChannel's: same rx power, delay and context.
+//
+// The default threshold is 10 dB below the SX1301 SF12 sensitivity, so what
+// gets dropped is not only undecodable but also too weak to matter as
+// interference at a gateway. The PacketSent trace is not fired.
+//
+// The frequency argument of Send and LoraPhy::StartReceive is a double in
+// MHz in older lorawan releases and a uint32_t in Hz in newer ones; the
+// override takes whatever LoraChannel::Send declares and passes it through.
+//
+// Needs LoraChannel::Send to be virtual; Dockerfile.LoRaWAN patches it and
+// fails the build if Send or LoraPhy::StartReceive no longer have the
+// signatures used below. There is no default constructor: the channel is
+// useless without its loss and delay models, so it has to be created with
+// CreateObject<RangeCulledLoraChannel>(loss, delay).
+class RangeCulledLoraChannel : public lorawan::LoraChannel {
+  template <typename Method>
+  struct LastArgument;
+  template <typename Class, typename... Args>
+  struct LastArgument<void (Class::*)(Args...) const> {
+    using type = typename std::tuple_element<sizeof...(Args) - 1, std::tuple<Args...>>::type;
+  };
+  using Frequency = typename LastArgument<decltype(&lorawan::LoraChannel::Send)>::type;
+
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::RangeCulledLoraChannel")
+      .SetParent<lorawan::LoraChannel>()
+      .AddAttribute("RxThresholdDbm", "Receivers a transmission would reach below this power are skipped.",
+                    DoubleValue(-152.5),
+                    MakeDoubleAccessor(&RangeCulledLoraChannel::m_rxThresholdDbm),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("CellSize", "Receiver grid cell size in metres (0 = useful range of the first transmission).",
+                    DoubleValue(0),
+                    MakeDoubleAccessor(&RangeCulledLoraChannel::m_cellSize),
+                    MakeDoubleChecker<double>(0))
+      .AddAttribute("RefreshInterval", "How often receivers moving without course changes are re-bucketed.",
+                    TimeValue(Seconds(1)),
+                    MakeTimeAccessor(&RangeCulledLoraChannel::m_refreshInterval),
+                    MakeTimeChecker());
+    return tid;
+  }
+
+  RangeCulledLoraChannel(Ptr<PropagationLossModel> loss, Ptr<PropagationDelayModel> delay)
+    : lorawan::LoraChannel(loss, delay),
+      m_loss(loss),
+      m_delay(delay) {
+    NS_ABORT_MSG_IF(!m_loss || !m_delay, "RangeCulledLoraChannel needs a loss and a delay model");
+  }
+
+  void Send(Ptr<lorawan::LoraPhy> sender, Ptr<Packet> packet, double txPowerDbm,
+            lorawan::LoraTxParameters txParams, Time duration, Frequency frequency) const override {
+    if (!m_culling.IsConfigured()) {
+      m_culling.Configure(m_loss, m_rxThresholdDbm, m_cellSize, m_refreshInterval, txPowerDbm);
+    }
+    m_culling.Sync(GetNDevices(), [this](std::size_t i) {
+      return DynamicCast<lorawan::LoraNetDevice>(GetDevice(i))->GetPhy();
+    });
+
+    Ptr<MobilityModel> senderMobility = sender->GetMobility();
+    m_culling.ForEachReceiver(senderMobility, txPowerDbm,
+                              [&](Ptr<lorawan::LoraPhy> phy, Ptr<MobilityModel> receiverMobility) {
+      if (phy == sender) {
+        return;
+      }
+      Time delay = m_delay->GetDelay(senderMobility, receiverMobility);
+      double rxPowerDbm = GetRxPower(txPowerDbm, senderMobility, receiverMobility);
+      uint32_t dstNode = 0;
+      if (phy->GetDevice() != nullptr) {
+        dstNode = phy->GetDevice()->GetNode()->GetId();
+      }
+      Simulator::ScheduleWithContext(dstNode, delay, &lorawan::LoraPhy::StartReceive, phy,
+                                     packet->Copy(), rxPowerDbm, txParams.sf, duration, frequency);
+    });
+  }
+
+  const ReceiverGrid<lorawan::LoraPhy> &GetGrid() const { return m_culling.GetGrid(); }
+
+private:
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<PropagationDelayModel> m_delay;
+  double m_rxThresholdDbm;
+  double m_cellSize;
+  Time m_refreshInterval;
+  mutable CulledDelivery<lorawan::LoraPhy> m_culling;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RangeCulledLoraChannel);
+
+} // namespace ns3
+
+#endif /* CULLED_LORA_CHANNEL_H */
@@ -0,0 +1,105 @@
+#ifndef CULLED_SIGFOX_CHANNEL_H
+#define CULLED_SIGFOX_CHANNEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/sigfox-channel.h"
+#include "ns3/sigfox-net-device.h"
+#include "ns3/sigfox-phy.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "range_culling.h"
+
+namespace ns3 {
+
+// ==================== RANGE-CULLED SIGFOX CHANNEL ====================
+// SigfoxChannel that only delivers a transmission to PHYs within its useful
+// range, i.e. where the loss model leaves it above RxThresholdDbm; the rest
+// are never evaluated or scheduled. Delivery to the receivers it does reach
+// is the same as SigfoxChannel's: same rx power, delay and context.
+//
+// The default threshold is 10 dB below a Sigfox base station's -142 dBm
+// sensitivity, so what gets dropped is not only undecodable but also too
+// weak to matter as interference. The PacketSent trace is not fired.
+//
+// With that threshold and sigfox.cc's loss model (LogDistance, exponent
+// 3.76, 7.7 dB at 1 m) a 14 dBm uplink stays above it for about 16 km, which
+// is also the default cell size. That covers the whole Boa Vista site area,
+// so in the stock scenarios every PHY remains a candidate and nothing is
+// culled; the channel only pays off over larger deployments or with
+// RxThresholdDbm raised towards the sensitivity (about 8.8 km at -142 dBm).
+//
+// Needs SigfoxChannel::Send to be virtual; Dockerfile.Sigfox patches it and
+// fails the build if Send or SigfoxPhy::StartReceive no longer have the
+// signatures used below. culling_check.cc checks the grid against a
+// brute-force scan. There is no default constructor: the channel is useless
+// without its loss and delay models, so it has to be created with
+// CreateObject<RangeCulledSigfoxChannel>(loss, delay).
+class RangeCulledSigfoxChannel : public sigfox::SigfoxChannel {
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::RangeCulledSigfoxChannel")
+      .SetParent<sigfox::SigfoxChannel>()
+      .AddAttribute("RxThresholdDbm", "Receivers a transmission would reach below this power are skipped.",
+                    DoubleValue(-152),
+                    MakeDoubleAccessor(&RangeCulledSigfoxChannel::m_rxThresholdDbm),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("CellSize", "Receiver grid cell size in metres (0 = useful range of the first transmission).",
+                    DoubleValue(0),
+                    MakeDoubleAccessor(&RangeCulledSigfoxChannel::m_cellSize),
+                    MakeDoubleChecker<double>(0))
+      .AddAttribute("RefreshInterval", "How often receivers moving without course changes are re-bucketed.",
+                    TimeValue(Seconds(1)),
+                    MakeTimeAccessor(&RangeCulledSigfoxChannel::m_refreshInterval),
+                    MakeTimeChecker());
+    return tid;
+  }
+
+  RangeCulledSigfoxChannel(Ptr<PropagationLossModel> loss, Ptr<PropagationDelayModel> delay)
+    : sigfox::SigfoxChannel(loss, delay),
+      m_loss(loss),
+      m_delay(delay) {
+    NS_ABORT_MSG_IF(!m_loss || !m_delay, "RangeCulledSigfoxChannel needs a loss and a delay model");
+  }
+
+  void Send(Ptr<sigfox::SigfoxPhy> sender, Ptr<Packet> packet, double txPowerDbm,
+            Time duration, double frequencyMHz) const override {
+    if (!m_culling.IsConfigured()) {
+      m_culling.Configure(m_loss, m_rxThresholdDbm, m_cellSize, m_refreshInterval, txPowerDbm);
+    }
+    m_culling.Sync(GetNDevices(), [this](std::size_t i) {
+      return DynamicCast<sigfox::SigfoxNetDevice>(GetDevice(i))->GetPhy();
+    });
+
+    Ptr<MobilityModel> senderMobility = sender->GetMobility();
+    m_culling.ForEachReceiver(senderMobility, txPowerDbm,
+                              [&](Ptr<sigfox::SigfoxPhy> phy, Ptr<MobilityModel> receiverMobility) {
+      if (phy == sender) {
+        return;
+      }
+      Time delay = m_delay->GetDelay(senderMobility, receiverMobility);
+      double rxPowerDbm = GetRxPower(txPowerDbm, senderMobility, receiverMobility);
+      uint32_t dstNode = 0;
+      if (phy->GetDevice() != nullptr) {
+        dstNode = phy->GetDevice()->GetNode()->GetId();
+      }
+      Simulator::ScheduleWithContext(dstNode, delay, &sigfox::SigfoxPhy::StartReceive, phy,
+                                     packet->Copy(), rxPowerDbm, duration, frequencyMHz);
+    });
+  }
+
+  const ReceiverGrid<sigfox::SigfoxPhy> &GetGrid() const { return m_culling.GetGrid(); }
+
+private:
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<PropagationDelayModel> m_delay;
+  double m_rxThresholdDbm;
+  double m_cellSize;
+  Time m_refreshInterval;
+  mutable CulledDelivery<sigfox::SigfoxPhy> m_culling;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RangeCulledSigfoxChannel);
+
+} // namespace ns3
+
+#endif /* CULLED_SIGFOX_CHANNEL_H */
@@ -0,0 +1,121 @@
+#ifndef CULLED_WIFI_CHANNEL_H
+#define CULLED_WIFI_CHANNEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-ppdu.h"
+#include "ns3/wifi-utils.h"
+#include "ns3/yans-wifi-channel.h"
+#include "ns3/yans-wifi-phy.h"
+#include "range_culling.h"
+
+namespace ns3 {
+
+// ==================== RANGE-CULLED YANS WIFI CHANNEL ====================
+// YansWifiChannel that only delivers a transmission to PHYs within its
+// useful range, i.e. where the loss model leaves it above RxThresholdDbm; the
+// rest are never evaluated or scheduled.
+//
+// YansWifiChannel::Receive is private, so delivery is done here the way it
+// does it: PHYs on a narrower channel than the sender are skipped, and a
+// signal below the PHY's RX sensitivity (scaled to the PPDU width, after RX
+// gain) is dropped without reaching the PHY at all, not even as
+// interference. That check is made when the transmission is sent instead of
+// when it arrives, which only removes events that would have done nothing.
+// Everything else (rx power, delay, context, the dummy band Yans uses) is
+// the same, and the PHY gets the PPDU through the public
+// WifiPhy::StartReceivePreamble.
+//
+// The default threshold is 10 dB below the PHY's default -101 dBm
+// sensitivity, which leaves room for RX gain; anything culled would have
+// been dropped by the sensitivity check anyway.
+//
+// Needs YansWifiChannel::Send to be virtual; Dockerfile.WiFi patches it and
+// fails the build if Send, Receive or WifiPhy::StartReceivePreamble no
+// longer look like what is reproduced below. There is no default
+// constructor: create it with CreateObject<RangeCulledYansWifiChannel>(loss,
+// delay).
+class RangeCulledYansWifiChannel : public YansWifiChannel {
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::RangeCulledYansWifiChannel")
+      .SetParent<YansWifiChannel>()
+      .AddAttribute("RxThresholdDbm", "Receivers a transmission would reach below this power are skipped.",
+                    DoubleValue(-111),
+                    MakeDoubleAccessor(&RangeCulledYansWifiChannel::m_rxThresholdDbm),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("CellSize", "Receiver grid cell size in metres (0 = useful range of the first transmission).",
+                    DoubleValue(0),
+                    MakeDoubleAccessor(&RangeCulledYansWifiChannel::m_cellSize),
+                    MakeDoubleChecker<double>(0))
+      .AddAttribute("RefreshInterval", "How often receivers moving without course changes are re-bucketed.",
+                    TimeValue(Seconds(1)),
+                    MakeTimeAccessor(&RangeCulledYansWifiChannel::m_refreshInterval),
+                    MakeTimeChecker());
+    return tid;
+  }
+
+  RangeCulledYansWifiChannel(Ptr<PropagationLossModel> loss, Ptr<PropagationDelayModel> delay)
+    : m_loss(loss),
+      m_delay(delay) {
+    NS_ABORT_MSG_IF(!m_loss || !m_delay, "RangeCulledYansWifiChannel needs a loss and a delay model");
+    SetPropagationLossModel(loss);
+    SetPropagationDelayModel(delay);
+  }
+
+  void Send(Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double txPowerDbm) const override {
+    if (!m_culling.IsConfigured()) {
+      m_culling.Configure(m_loss, m_rxThresholdDbm, m_cellSize, m_refreshInterval, txPowerDbm);
+    }
+    m_culling.Sync(GetNDevices(), [this](std::size_t i) {
+      return DynamicCast<YansWifiPhy>(DynamicCast<WifiNetDevice>(GetDevice(i))->GetPhy());
+    });
+
+    Ptr<MobilityModel> senderMobility = sender->GetMobility();
+    NS_ASSERT(senderMobility);
+    m_culling.ForEachReceiver(senderMobility, txPowerDbm,
+                              [&](Ptr<YansWifiPhy> phy, Ptr<MobilityModel> receiverMobility) {
+      if (phy == sender || phy->GetChannelWidth() < sender->GetChannelWidth()) {
+        return;
+      }
+      double rxPowerDbm = m_loss->CalcRxPower(txPowerDbm, senderMobility, receiverMobility);
+      auto txWidth = ppdu->GetTxChannelWidth();
+      if (rxPowerDbm + phy->GetRxGain() < phy->GetRxSensitivity() + RatioToDb(txWidth / 20.0)) {
+        return;
+      }
+      Time delay = m_delay->GetDelay(senderMobility, receiverMobility);
+      uint32_t dstNode = 0xffffffff;
+      if (phy->GetDevice() != nullptr) {
+        dstNode = phy->GetDevice()->GetNode()->GetId();
+      }
+      Simulator::ScheduleWithContext(dstNode, delay, &RangeCulledYansWifiChannel::Deliver, phy,
+                                     ppdu->Copy(), DbmToW(rxPowerDbm + phy->GetRxGain()),
+                                     phy->GetBand(txWidth));
+    });
+  }
+
+  const ReceiverGrid<YansWifiPhy> &GetGrid() const { return m_culling.GetGrid(); }
+
+private:
+  static void Deliver(Ptr<YansWifiPhy> phy, Ptr<const WifiPpdu> ppdu, double rxPowerW,
+                      RxPowerWattPerChannelBand::key_type band) {
+    RxPowerWattPerChannelBand rxPowersW;
+    rxPowersW.insert({band, rxPowerW});
+    phy->StartReceivePreamble(ppdu, rxPowersW, ppdu->GetTxDuration());
+  }
+
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<PropagationDelayModel> m_delay;
+  double m_rxThresholdDbm;
+  double m_cellSize;
+  Time m_refreshInterval;
+  mutable CulledDelivery<YansWifiPhy> m_culling;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RangeCulledYansWifiChannel);
+
+} // namespace ns3
+
+#endif /* CULLED_WIFI_CHANNEL_H */
@@ -0,0 +1,193 @@
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "range_culling.h"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("CullingCheck");
+
+// Brute-force check of the receiver grid behind RangeCulledLoraChannel and
+// RangeCulledSigfoxChannel: receivers drive around a square, changing course
+// now and then, and at every transmission the candidates CulledDelivery
+// returns are compared with a scan of every receiver through the loss model.
+// A receiver the transmission reaches above the threshold that is not among
+// the candidates is a miss, and any miss fails the run.
+
+// ==================== RECEIVERS ====================
+// Stands in for LoraPhy/SigfoxPhy; the grid only needs the mobility.
+class CheckPhy : public Object {
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::CullingCheckPhy").SetParent<Object>();
+    return tid;
+  }
+
+  CheckPhy() : m_index(0) {}
+
+  void Setup(uint32_t index, Ptr<MobilityModel> mobility) {
+    m_index = index;
+    m_mobility = mobility;
+  }
+
+  uint32_t GetIndex() const { return m_index; }
+  Ptr<MobilityModel> GetMobility() const { return m_mobility; }
+
+private:
+  uint32_t m_index;
+  Ptr<MobilityModel> m_mobility;
+};
+
+// ==================== CHECK ====================
+class CullingCheck {
+public:
+  CullingCheck(uint32_t receivers, double side, double maxSpeed, double txPowerDbm,
+               double thresholdDbm, Time txInterval, Time turnInterval, uint32_t seed)
+    : m_maxSpeed(maxSpeed),
+      m_txPowerDbm(txPowerDbm),
+      m_thresholdDbm(thresholdDbm),
+      m_txInterval(txInterval),
+      m_turnInterval(turnInterval),
+      m_rng(seed),
+      m_seen(receivers, false),
+      m_transmissions(0),
+      m_candidates(0),
+      m_inRange(0),
+      m_misses(0) {
+    Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel>();
+    loss->SetPathLossExponent(3.76);
+    loss->SetReference(1, 7.7);
+    m_loss = loss;
+    m_culling.Configure(m_loss, m_thresholdDbm, 0, Seconds(1), m_txPowerDbm);
+
+    // Half the receivers start parked, the rest driving
+    std::uniform_real_distribution<double> position(0, side);
+    for (uint32_t i = 0; i < receivers; ++i) {
+      Ptr<ConstantVelocityMobilityModel> mobility = CreateObject<ConstantVelocityMobilityModel>();
+      mobility->SetPosition(Vector(position(m_rng), position(m_rng), 0));
+      mobility->SetVelocity(i % 2 ? RandomVelocity() : Vector(0, 0, 0));
+      Ptr<CheckPhy> phy = CreateObject<CheckPhy>();
+      phy->Setup(i, mobility);
+      m_mobilities.push_back(mobility);
+      m_phys.push_back(phy);
+    }
+    m_culling.Sync(m_phys.size(), [this](std::size_t i) { return m_phys[i]; });
+  }
+
+  void Start() {
+    Simulator::Schedule(m_turnInterval, &CullingCheck::Turn, this);
+    Simulator::Schedule(m_txInterval, &CullingCheck::Transmit, this);
+  }
+
+  void Print(std::ostream &os) {
+    os << "Useful range: " << m_culling.GetRange(m_txPowerDbm) << " m, cell "
+       << m_culling.GetGrid().GetCellSize() << " m\n"
+       << "Receivers: " << m_phys.size() << ", transmissions: " << m_transmissions << "\n"
+       << std::fixed << std::setprecision(1)
+       << "Per transmission: " << static_cast<double>(m_candidates) / m_transmissions
+       << " candidates, " << static_cast<double>(m_inRange) / m_transmissions
+       << " in range\n"
+       << "Misses: " << m_misses << std::endl;
+  }
+
+  uint64_t GetTransmissions() const { return m_transmissions; }
+  uint64_t GetMisses() const { return m_misses; }
+
+private:
+  Vector RandomVelocity() {
+    std::uniform_real_distribution<double> component(-m_maxSpeed, m_maxSpeed);
+    return Vector(component(m_rng), component(m_rng), 0);
+  }
+
+  // Sends a few receivers off in a new direction, and stops one in three
+  void Turn() {
+    for (uint32_t k = 0; k < 1 + m_phys.size() / 400; ++k) {
+      Ptr<ConstantVelocityMobilityModel> mobility = m_mobilities[m_rng() % m_mobilities.size()];
+      mobility->SetVelocity(m_rng() % 3 == 0 ? Vector(0, 0, 0) : RandomVelocity());
+    }
+    Simulator::Schedule(m_turnInterval, &CullingCheck::Turn, this);
+  }
+
+  void Transmit() {
+    Ptr<MobilityModel> sender = m_phys[m_rng() % m_phys.size()]->GetMobility();
+    std::fill(m_seen.begin(), m_seen.end(), false);
+    m_culling.ForEachReceiver(sender, m_txPowerDbm, [this](Ptr<CheckPhy> phy, Ptr<MobilityModel>) {
+      m_seen[phy->GetIndex()] = true;
+      m_candidates++;
+    });
+    for (Ptr<CheckPhy> phy : m_phys) {
+      if (m_loss->CalcRxPower(m_txPowerDbm, sender, phy->GetMobility()) < m_thresholdDbm) {
+        continue;
+      }
+      m_inRange++;
+      if (!m_seen[phy->GetIndex()]) {
+        m_misses++;
+      }
+    }
+    m_transmissions++;
+    Simulator::Schedule(m_txInterval, &CullingCheck::Transmit, this);
+  }
+
+  double m_maxSpeed;
+  double m_txPowerDbm;
+  double m_thresholdDbm;
+  Time m_txInterval;
+  Time m_turnInterval;
+  std::mt19937_64 m_rng;
+  Ptr<PropagationLossModel> m_loss;
+  CulledDelivery<CheckPhy> m_culling;
+  std::vector<Ptr<CheckPhy>> m_phys;
+  std::vector<Ptr<ConstantVelocityMobilityModel>> m_mobilities;
+  std::vector<bool> m_seen;
+  uint64_t m_transmissions;
+  uint64_t m_candidates;
+  uint64_t m_inRange;
+  uint64_t m_misses;
+};
+
+int main(int argc, char *argv[]) {
+  uint32_t receivers = 20000;
+  double side = 200000;
+  double maxSpeed = 20;
+  double txPowerDbm = 14;
+  double thresholdDbm = -152;
+  Time txInterval = MilliSeconds(50);
+  Time turnInterval = MilliSeconds(370);
+  Time simTime = Seconds(60);
+  uint32_t seed = 1;
+
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("receivers", "Receivers on the channel", receivers);
+  cmd.AddValue("side", "Side of the square they drive around in (m)", side);
+  cmd.AddValue("maxSpeed", "Largest speed along each axis (m/s)", maxSpeed);
+  cmd.AddValue("txPowerDbm", "Transmission power (dBm)", txPowerDbm);
+  cmd.AddValue("thresholdDbm", "Power below which a receiver may be culled (dBm)", thresholdDbm);
+  cmd.AddValue("txInterval", "Time between transmissions", txInterval);
+  cmd.AddValue("turnInterval", "Time between course changes", turnInterval);
+  cmd.AddValue("simTime", "Simulated time", simTime);
+  cmd.AddValue("seed", "Placement and movement seed", seed);
+  cmd.Parse(argc, argv);
+
+  CullingCheck check(receivers, side, maxSpeed, txPowerDbm, thresholdDbm, txInterval,
+                     turnInterval, seed);
+  check.Start();
+  Simulator::Stop(simTime);
+  Simulator::Run();
+  Simulator::Destroy();
+
+  if (check.GetTransmissions() == 0) {
+    NS_LOG_UNCOND("No transmissions; simTime is shorter than txInterval");
+    return 1;
+  }
+  check.Print(std::cout);
+  if (check.GetMisses() > 0) {
+    NS_LOG_UNCOND("The grid missed receivers the brute-force scan reaches");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,264 @@
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "dead_reckoning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("DeadReckoningComparison");
+
+// Replays the SUMO trace and, for each technology, compares fixed-period
+// reporting with dead-reckoning suppression: messages sent, airtime, radio
+// energy, and how far the server's reconstruction (last report extrapolated
+// along its velocity, for both policies) is from the true position.
+//
+// The radios are modelled per report rather than simulated, with the same
+// constants the technology sims use, so the comparison runs in the Sigfox
+// image without the NB-IoT or LoRaWAN stacks. Reports are only ever sent
+// when the technology allows it: LoRa waits out its duty cycle and Sigfox
+// spends its daily message budget evenly, with a short burst allowance.
+
+// ==================== RADIO MODELS ====================
+struct RadioModel {
+  const char *name;
+  double fixedPeriod;       // s, period of the fixed policy
+  uint32_t payloadBytes;
+  double airtime;           // s on air per report
+  double txCurrent;         // A
+  double dutyCycle;         // 1 = unrestricted
+  double dailyLimit;        // reports per 24 h, 0 = unlimited
+  double burst;             // reports that can be sent back to back within the daily limit
+  // RRC connection around each report (NB-IoT only)
+  double setupTime;         // s, random access plus connection setup
+  double connectedCurrent;  // A
+  double inactivityTimer;   // s before release to idle
+};
+
+// LoRa time on air, BW 125 kHz, CR 4/5, explicit header, CRC on (SX1276 datasheet)
+double LoraAirtime(uint8_t sf, uint32_t payloadBytes) {
+  double symbol = std::pow(2.0, sf) / 125000.0;
+  int lowDataRate = sf >= 11 ? 1 : 0;
+  double numerator = 8.0 * payloadBytes - 4.0 * sf + 28 + 16;
+  double payloadSymbols =
+    8 + std::max(std::ceil(numerator / (4.0 * (sf - 2 * lowDataRate))) * 5, 0.0);
+  return (8 + 4.25 + payloadSymbols) * symbol;
+}
+
+// Sigfox uplink: 14 B of framing around the payload at 100 bit/s, sent 3 times
+double SigfoxAirtime(uint32_t payloadBytes) {
+  return 3 * (payloadBytes + 14) * 8 / 100.0;
+}
+
+enum Technology { NB_IOT, LORA, SIGFOX, NUM_TECHNOLOGIES };
+enum Policy { FIXED, DEAD_RECKONING, NUM_POLICIES };
+const char *POLICY_NAMES[NUM_POLICIES] = {"fixed", "dead-reckoning"};
+
+// ==================== REPORTING ====================
+// One device under one technology and policy
+class Reporter {
+public:
+  Reporter(const RadioModel &radio, Policy policy, double errorBound, Time maxSilence, double voltage)
+    : m_radio(radio),
+      m_fixed(policy == FIXED),
+      m_policy(errorBound, maxSilence),
+      m_voltage(voltage),
+      m_lastReport(-1e9),
+      m_connectedUntil(-1e9),
+      m_tokens(radio.burst),
+      m_lastRefill(0) {}
+
+  // Reports if the policy wants to and the radio may; returns true if sent.
+  bool Check(Time now, const Vector &position, const Vector &velocity) {
+    double t = now.GetSeconds();
+    bool wanted = m_fixed ? t - m_lastReport >= m_radio.fixedPeriod - 1e-9
+                          : m_policy.ShouldReport(now, position);
+    if (!wanted) {
+      return false;
+    }
+    if (!MayTransmit(t)) {
+      deferred++;
+      return false;
+    }
+    m_lastReport = t;
+    if (m_radio.dailyLimit > 0) {
+      m_tokens -= 1;
+    }
+    m_policy.OnReport(now, position, velocity);
+    messages++;
+    airtime += m_radio.airtime;
+    energy += ReportEnergy(t);
+    return true;
+  }
+
+  uint64_t messages = 0;
+  uint64_t deferred = 0;  // reports held back by duty cycle or message budget
+  double airtime = 0;
+  double energy = 0;      // J
+
+private:
+  bool MayTransmit(double t) {
+    if (t - m_lastReport < m_radio.airtime / m_radio.dutyCycle) {
+      return false;
+    }
+    if (m_radio.dailyLimit > 0) {
+      m_tokens = std::min(m_radio.burst, m_tokens + (t - m_lastRefill) * m_radio.dailyLimit / 86400);
+      m_lastRefill = t;
+      return m_tokens >= 1;
+    }
+    return true;
+  }
+
+  // Radio energy of one report, including the connected time it adds
+  double ReportEnergy(double t) {
+    double charge = m_radio.airtime * m_radio.txCurrent;
+    if (m_radio.inactivityTimer > 0) {
+      if (t >= m_connectedUntil) {
+        charge += (m_radio.setupTime + m_radio.inactivityTimer) * m_radio.connectedCurrent;
+        m_connectedUntil = t + m_radio.setupTime + m_radio.airtime + m_radio.inactivityTimer;
+      } else {
+        // Already connected: the TX replaces connected time and the tail restarts
+        double end = t + m_radio.airtime + m_radio.inactivityTimer;
+        charge -= m_radio.airtime * m_radio.connectedCurrent;
+        charge += std::max(end - m_connectedUntil, 0.0) * m_radio.connectedCurrent;
+        m_connectedUntil = std::max(end, m_connectedUntil);
+      }
+    }
+    return charge * m_voltage;
+  }
+
+  const RadioModel &m_radio;
+  bool m_fixed;
+  DeadReckoningPolicy m_policy;
+  double m_voltage;
+  double m_lastReport;
+  double m_connectedUntil;
+  double m_tokens;
+  double m_lastRefill;
+};
+
+struct Run {
+  std::vector<Reporter> devices;
+  ReconstructionTracker server;
+};
+
+std::vector<RadioModel> radios;
+Run runs[NUM_TECHNOLOGIES][NUM_POLICIES];
+
+void Check(NodeContainer nodes, Time interval) {
+  Time now = Simulator::Now();
+  for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+    Ptr<MobilityModel> mobility = nodes.Get(i)->GetObject<MobilityModel>();
+    if (mobility == nullptr) {
+      continue;
+    }
+    Vector position = mobility->GetPosition();
+    Vector velocity = mobility->GetVelocity();
+    for (int tech = 0; tech < NUM_TECHNOLOGIES; ++tech) {
+      for (int policy = 0; policy < NUM_POLICIES; ++policy) {
+        Run &run = runs[tech][policy];
+        if (run.devices[i].Check(now, position, velocity)) {
+          run.server.OnReport(i, now, position, velocity);
+        }
+        run.server.Sample(i, position);
+      }
+    }
+  }
+  Simulator::Schedule(interval, &Check, nodes, interval);
+}
+
+int main(int argc, char *argv[]) {
+  std::string trace = "scratch/ns3.tcl";
+  uint32_t nodes = 1;
+  double simTime = 600;
+  double errorBound = 25;
+  Time checkInterval = Seconds(1);
+  Time maxSilence = Seconds(300);
+  double voltage = 3.3;
+  uint32_t loraSf = 7;
+  double loraPeriod = 10;
+  double sigfoxPeriod = 620;
+
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("trace", "Ns2 mobility trace exported from SUMO", trace);
+  cmd.AddValue("nodes", "Nodes in the trace", nodes);
+  cmd.AddValue("simTime", "Seconds of trace to replay", simTime);
+  cmd.AddValue("errorBound", "Report when the server's prediction is off by more than this (m)", errorBound);
+  cmd.AddValue("checkInterval", "How often the device compares its position with the prediction", checkInterval);
+  cmd.AddValue("maxSilence", "Longest time between dead-reckoning reports", maxSilence);
+  cmd.AddValue("voltage", "Supply voltage (V)", voltage);
+  cmd.AddValue("loraSf", "LoRa spreading factor", loraSf);
+  cmd.AddValue("loraPeriod", "LoRa fixed report period (s), at least the duty-cycle off time", loraPeriod);
+  cmd.AddValue("sigfoxPeriod", "Sigfox fixed report period (s), 140 messages a day at most", sigfoxPeriod);
+  cmd.Parse(argc, argv);
+
+  // Same constants as NbIotPowerSavingController / NbIotRadioEnergyModel,
+  // the lorawan.cc radio energy model and sigfox.cc respectively
+  RadioModel nbIot = {"NB-IoT", checkInterval.GetSeconds(), 200, 200 * 8 / 20000.0, 0.220,
+                      1, 0, 0, 1.5, 0.046, 20};
+  RadioModel lora = {"LoRa", loraPeriod, 20, LoraAirtime(loraSf, 20), 0.028,
+                     0.01, 0, 0, 0, 0, 0};
+  RadioModel sigfox = {"Sigfox", sigfoxPeriod, 12, SigfoxAirtime(12), 0.047,
+                       1, 140, 4, 0, 0, 0};
+  radios = {nbIot, lora, sigfox};
+
+  NodeContainer ueNodes;
+  ueNodes.Create(nodes);
+  Ns2MobilityHelper ns2(trace);
+  ns2.Install();
+
+  for (int tech = 0; tech < NUM_TECHNOLOGIES; ++tech) {
+    for (int policy = 0; policy < NUM_POLICIES; ++policy) {
+      for (uint32_t i = 0; i < nodes; ++i) {
+        runs[tech][policy].devices.push_back(
+          Reporter(radios[tech], static_cast<Policy>(policy), errorBound, maxSilence, voltage));
+      }
+    }
+  }
+
+  Simulator::Schedule(Seconds(0), &Check, ueNodes, checkInterval);
+  Simulator::Stop(Seconds(simTime));
+  Simulator::Run();
+  Simulator::Destroy();
+
+  std::cout << "Error bound " << errorBound << " m, max silence " << maxSilence.GetSeconds()
+            << " s, " << nodes << " node(s), " << simTime << " s\n"
+            << std::setw(8) << "tech" << std::setw(16) << "policy"
+            << std::setw(10) << "messages" << std::setw(10) << "deferred"
+            << std::setw(12) << "airtime s" << std::setw(12) << "energy J"
+            << std::setw(10) << "err mean" << std::setw(10) << "err p95"
+            << std::setw(10) << "err max" << std::endl;
+  for (int tech = 0; tech < NUM_TECHNOLOGIES; ++tech) {
+    double energy[NUM_POLICIES];
+    for (int policy = 0; policy < NUM_POLICIES; ++policy) {
+      Run &run = runs[tech][policy];
+      uint64_t messages = 0, deferred = 0;
+      double airtime = 0;
+      energy[policy] = 0;
+      for (const Reporter &device : run.devices) {
+        messages += device.messages;
+        deferred += device.deferred;
+        airtime += device.airtime;
+        energy[policy] += device.energy;
+      }
+      const DistanceStats &error = run.server.GetError();
+      std::cout << std::setw(8) << radios[tech].name << std::setw(16) << POLICY_NAMES[policy]
+                << std::setw(10) << messages << std::setw(10) << deferred
+                << std::setw(12) << std::fixed << std::setprecision(2) << airtime
+                << std::setw(12) << energy[policy]
+                << std::setw(10) << std::setprecision(1) << error.GetMean()
+                << std::setw(10) << error.GetPercentile(0.95)
+                << std::setw(10) << error.GetMax() << std::endl;
+    }
+    if (energy[FIXED] > 0) {
+      NS_LOG_UNCOND(radios[tech].name << ": dead reckoning saves "
+                    << 100 * (1 - energy[DEAD_RECKONING] / energy[FIXED]) << "% radio energy");
+    }
+  }
+  return 0;
+}
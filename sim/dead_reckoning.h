@@ -0,0 +1,108 @@
+#ifndef DEAD_RECKONING_H
+#define DEAD_RECKONING_H
+
+#include "ns3/core-module.h"
+#include "ns3/vector.h"
+#include "distance_stats.h"
+
+#include <cmath>
+#include <unordered_map>
+
+namespace ns3 {
+
+// ==================== MOTION PREDICTOR ====================
+// Last reported position extrapolated along the last reported velocity. The
+// device and the server each run one, fed with the same decoded report, so
+// the device knows exactly where the server currently thinks it is.
+class DeadReckoningPredictor {
+public:
+  DeadReckoningPredictor() : m_valid(false) {}
+
+  void Update(Time at, const Vector &position, const Vector &velocity) {
+    m_time = at;
+    m_position = position;
+    m_velocity = velocity;
+    m_valid = true;
+  }
+
+  bool IsValid() const { return m_valid; }
+  Time GetLastUpdate() const { return m_time; }
+
+  Vector Predict(Time at) const {
+    double dt = (at - m_time).GetSeconds();
+    return Vector(m_position.x + m_velocity.x * dt, m_position.y + m_velocity.y * dt, m_position.z);
+  }
+
+  // Horizontal distance between `position` and the prediction for `at`.
+  double GetError(Time at, const Vector &position) const {
+    Vector predicted = Predict(at);
+    double dx = position.x - predicted.x;
+    double dy = position.y - predicted.y;
+    return std::sqrt(dx * dx + dy * dy);
+  }
+
+private:
+  Time m_time;
+  Vector m_position;
+  Vector m_velocity;
+  bool m_valid;
+};
+
+// ==================== REPORTING POLICY ====================
+// Device side: report when the true position has drifted more than
+// errorBound metres from the shared prediction, and at least every
+// maxSilence so the server can tell a parked device from a dead one.
+class DeadReckoningPolicy {
+public:
+  DeadReckoningPolicy(double errorBound, Time maxSilence)
+    : m_errorBound(errorBound), m_maxSilence(maxSilence) {}
+
+  bool ShouldReport(Time now, const Vector &position) const {
+    if (!m_predictor.IsValid() || now - m_predictor.GetLastUpdate() >= m_maxSilence) {
+      return true;
+    }
+    return m_predictor.GetError(now, position) > m_errorBound;
+  }
+
+  // Call with the report as the server will decode it (quantised), not the
+  // raw mobility values, so both predictors stay identical.
+  void OnReport(Time at, const Vector &position, const Vector &velocity) {
+    m_predictor.Update(at, position, velocity);
+  }
+
+  const DeadReckoningPredictor &GetPredictor() const { return m_predictor; }
+
+private:
+  double m_errorBound;
+  Time m_maxSilence;
+  DeadReckoningPredictor m_predictor;
+};
+
+// ==================== SERVER RECONSTRUCTION ====================
+// Server side: one predictor per device, updated from received reports, and
+// the distance between where it puts each device and where the device really
+// is, sampled by the caller against ground truth.
+class ReconstructionTracker {
+public:
+  void OnReport(uint32_t device, Time at, const Vector &position, const Vector &velocity) {
+    m_predictors[device].Update(at, position, velocity);
+  }
+
+  // Adds one error sample if the device has reported at least once.
+  void Sample(uint32_t device, const Vector &truth) {
+    auto found = m_predictors.find(device);
+    if (found != m_predictors.end()) {
+      m_error.Add(found->second.GetError(Simulator::Now(), truth));
+    }
+  }
+
+  const DistanceStats &GetError() const { return m_error; }
+
+private:
+  std::unordered_map<uint32_t, DeadReckoningPredictor> m_predictors;
+  DistanceStats m_error;
+};
+
+} // namespace ns3
+
+#endif /* DEAD_RECKONING_H */
@@ -0,0 +1,65 @@
+#ifndef DISTANCE_STATS_H
+#define DISTANCE_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== DISTANCE STATISTICS ====================
+// Distance statistics in 1 m bins, so percentiles stay cheap to keep for
+// long runs and many vehicles. Errors past the last bin only count towards
+// the mean and the maximum.
+class DistanceStats {
+public:
+  DistanceStats() : m_count(0), m_sum(0), m_max(0), m_bins(NUM_BINS + 1, 0) {}
+
+  void Add(double error) {
+    m_count++;
+    m_sum += error;
+    m_max = std::max(m_max, error);
+    m_bins[std::min<std::size_t>(static_cast<std::size_t>(error / BIN_WIDTH), NUM_BINS)]++;
+  }
+
+  void Merge(const DistanceStats &other) {
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = std::max(m_max, other.m_max);
+    for (uint32_t i = 0; i <= NUM_BINS; ++i) {
+      m_bins[i] += other.m_bins[i];
+    }
+  }
+
+  uint64_t GetCount() const { return m_count; }
+  double GetMean() const { return m_count > 0 ? m_sum / m_count : 0.0; }
+  double GetMax() const { return m_max; }
+
+  // Upper edge of the bin holding the p-th fraction of the samples.
+  double GetPercentile(double p) const {
+    uint64_t target = static_cast<uint64_t>(std::ceil(p * m_count));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NUM_BINS; ++i) {
+      seen += m_bins[i];
+      if (seen >= target) {
+        return std::min((i + 1) * BIN_WIDTH, m_max);
+      }
+    }
+    return m_max;
+  }
+
+private:
+  static constexpr double BIN_WIDTH = 1.0;
+  static const uint32_t NUM_BINS = 2000;
+
+  uint64_t m_count;
+  double m_sum;
+  double m_max;
+  std::vector<uint64_t> m_bins;
+};
+
+} // namespace ns3
+
+#endif /* DISTANCE_STATS_H */
@@ -0,0 +1,153 @@
+#ifndef ENERGY_LEDGER_H
+#define ENERGY_LEDGER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== ENERGY LEDGER ====================
+// Per-device battery bookkeeping for large fleets, kept as a struct of
+// arrays. Periodic terms (sensor measurements, self-discharge) are applied to
+// every device in a single pass over contiguous doubles, which the compiler
+// vectorises, instead of scheduling one simulator event per device.
+//
+// Units are whatever the scenario uses for its battery; all columns must
+// agree. Radio energy is the running total reported by each device's
+// TotalEnergyConsumption trace.
+class EnergyLedger {
+public:
+  EnergyLedger() {}
+
+  EnergyLedger(std::size_t devices, double capacity) {
+    Resize(devices, capacity);
+  }
+
+  void Resize(std::size_t devices, double capacity) {
+    m_capacity.assign(devices, capacity);
+    m_radio.assign(devices, 0.0);
+    m_measurement.assign(devices, 0.0);
+    m_selfDischarge.assign(devices, 0.0);
+    m_compute.assign(devices, 0.0);
+    m_remaining.assign(devices, capacity);
+  }
+
+  std::size_t GetN() const { return m_capacity.size(); }
+
+  void SetRadioEnergy(std::size_t device, double totalEnergy) {
+    m_radio[device] = totalEnergy;
+  }
+
+  // Charges one measurement to every device. A device cannot draw more than
+  // it has left, so depleted devices stop accumulating.
+  void ApplyMeasurement(double charge) {
+    const std::size_t n = GetN();
+    const double *__restrict capacity = m_capacity.data();
+    const double *__restrict radio = m_radio.data();
+    const double *__restrict selfDischarge = m_selfDischarge.data();
+    const double *__restrict compute = m_compute.data();
+    double *__restrict measurement = m_measurement.data();
+    double *__restrict remaining = m_remaining.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      double left = capacity[i] - radio[i] - measurement[i] - selfDischarge[i] - compute[i];
+      left = left > 0.0 ? left : 0.0;
+      double spent = left < charge ? left : charge;
+      measurement[i] += spent;
+      remaining[i] = left - spent;
+    }
+  }
+
+  // Self-discharge of `rate` of the remaining charge per `window`, applied
+  // for `elapsed` (same time unit as `window`).
+  void ApplySelfDischarge(double rate, double window, double elapsed) {
+    const double k = rate * elapsed / window;
+    const std::size_t n = GetN();
+    const double *__restrict capacity = m_capacity.data();
+    const double *__restrict radio = m_radio.data();
+    const double *__restrict measurement = m_measurement.data();
+    const double *__restrict compute = m_compute.data();
+    double *__restrict selfDischarge = m_selfDischarge.data();
+    double *__restrict remaining = m_remaining.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      double left = capacity[i] - radio[i] - measurement[i] - selfDischarge[i] - compute[i];
+      left = left > 0.0 ? left : 0.0;
+      double lost = k * left;
+      selfDischarge[i] += lost;
+      remaining[i] = left - lost;
+    }
+  }
+
+  // Charges on-device computation (e.g. sealing a sync batch) to every
+  // device, capped like ApplyMeasurement.
+  void ApplyCompute(double charge) {
+    const std::size_t n = GetN();
+    const double *__restrict capacity = m_capacity.data();
+    const double *__restrict radio = m_radio.data();
+    const double *__restrict measurement = m_measurement.data();
+    const double *__restrict selfDischarge = m_selfDischarge.data();
+    double *__restrict compute = m_compute.data();
+    double *__restrict remaining = m_remaining.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      double left = capacity[i] - radio[i] - measurement[i] - selfDischarge[i] - compute[i];
+      left = left > 0.0 ? left : 0.0;
+      double spent = left < charge ? left : charge;
+      compute[i] += spent;
+      remaining[i] = left - spent;
+    }
+  }
+
+  // Recomputes the remaining column from the consumption columns.
+  void Refresh() {
+    const std::size_t n = GetN();
+    const double *__restrict capacity = m_capacity.data();
+    const double *__restrict radio = m_radio.data();
+    const double *__restrict measurement = m_measurement.data();
+    const double *__restrict selfDischarge = m_selfDischarge.data();
+    const double *__restrict compute = m_compute.data();
+    double *__restrict remaining = m_remaining.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      double left = capacity[i] - radio[i] - measurement[i] - selfDischarge[i] - compute[i];
+      remaining[i] = left > 0.0 ? left : 0.0;
+    }
+  }
+
+  double GetCapacity(std::size_t device) const { return m_capacity[device]; }
+  double GetRadioEnergy(std::size_t device) const { return m_radio[device]; }
+  double GetMeasurementEnergy(std::size_t device) const { return m_measurement[device]; }
+  double GetSelfDischarge(std::size_t device) const { return m_selfDischarge[device]; }
+  double GetComputeEnergy(std::size_t device) const { return m_compute[device]; }
+
+  // Remaining columns are as of the last Refresh/Apply* call.
+  double GetRemaining(std::size_t device) const { return m_remaining[device]; }
+
+  double GetMeanRemaining() const {
+    double sum = 0.0;
+    for (double r : m_remaining) {
+      sum += r;
+    }
+    return GetN() > 0 ? sum / GetN() : 0.0;
+  }
+
+  double GetMinRemaining() const {
+    return GetN() > 0 ? *std::min_element(m_remaining.begin(), m_remaining.end()) : 0.0;
+  }
+
+  std::size_t CountDepleted() const {
+    return std::count_if(m_remaining.begin(), m_remaining.end(),
+                         [](double r) { return r <= 0.0; });
+  }
+
+private:
+  std::vector<double> m_capacity;
+  std::vector<double> m_radio;
+  std::vector<double> m_measurement;
+  std::vector<double> m_selfDischarge;
+  std::vector<double> m_compute;
+  std::vector<double> m_remaining;
+};
+
+} // namespace ns3
+
+#endif /* ENERGY_LEDGER_H */
@@ -0,0 +1,353 @@
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include "ns3/core-module.h"
+#include "ns3/scheduler.h"
+#include "ns3/map-scheduler.h"
+
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace ns3 {
+
+// ==================== EVENT PROFILER ====================
+// Wall-clock profile of the event loop, opt-in through EnableEventProfiler().
+// It is a scheduler that forwards to a regular one (MapScheduler by default)
+// and times each event from the moment the simulator takes it out of the
+// queue (RemoveNext) to the moment it comes back to ask for more (IsEmpty).
+// That window is exactly the event's Invoke(), including everything it
+// schedules and logs, so nothing in the models needs instrumenting.
+//
+// Events are attributed to the node in whose context they run, and to their
+// label if they were scheduled through ScheduleLabelled. Unlabelled events
+// fall back to their concrete EventImpl type. MakeEvent instantiates that
+// per callee *signature*, so every void() function shares one row, as do
+// member functions of one class with the same parameters; the sims label
+// their own handlers, and what is left is mostly module code, where the
+// class usually tells events apart. Timing uses the TSC where available,
+// calibrated against steady_clock over the run.
+// Wraps an event with the name it is profiled under. The label must outlive
+// the run (a string literal).
+class LabelledEvent : public EventImpl {
+public:
+  LabelledEvent(const char *label, EventImpl *event) : m_label(label), m_event(event, false) {}
+
+  const char *GetLabel() const { return m_label; }
+
+private:
+  void Notify() override { m_event->Invoke(); }
+
+  const char *m_label;
+  Ptr<EventImpl> m_event;
+};
+
+// Simulator::Schedule, with the event profiled under `label`.
+template <typename... Ts>
+EventId ScheduleLabelled(const char *label, const Time &delay, Ts... args) {
+  return Simulator::Schedule(delay, Ptr<EventImpl>(new LabelledEvent(label, MakeEvent(args...)), false));
+}
+
+class ProfilingScheduler : public Scheduler {
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::ProfilingScheduler")
+      .SetParent<Scheduler>()
+      .AddConstructor<ProfilingScheduler>()
+      .AddAttribute("Scheduler", "Scheduler the events are actually kept in.",
+                    StringValue("ns3::MapScheduler"),
+                    MakeStringAccessor(&ProfilingScheduler::SetSchedulerType),
+                    MakeStringChecker())
+      .AddAttribute("TimelineInterval", "Wall-clock width of each timeline bucket, in seconds.",
+                    DoubleValue(1.0),
+                    MakeDoubleAccessor(&ProfilingScheduler::m_timelineInterval),
+                    MakeDoubleChecker<double>(0.001));
+    return tid;
+  }
+
+  ProfilingScheduler()
+    : m_timelineInterval(1.0),
+      m_running(false),
+      m_eventStart(0),
+      m_eventEnd(0),
+      m_current(nullptr),
+      m_currentLabel(nullptr),
+      m_currentContext(0),
+      m_startTicks(0),
+      m_bucketTicks(0),
+      m_events(0) {
+    Instance() = this;
+  }
+
+  ~ProfilingScheduler() override {
+    if (Instance() == this) {
+      Instance() = nullptr;
+    }
+  }
+
+  void Insert(const Event &ev) override { m_scheduler->Insert(ev); }
+
+  bool IsEmpty() const override {
+    // Also called from inside events; only the last call before the next
+    // RemoveNext is the event loop's, so just remember when it happened.
+    m_eventEnd = ReadTicks();
+    return m_scheduler->IsEmpty();
+  }
+
+  Event PeekNext() const override { return m_scheduler->PeekNext(); }
+
+  Event RemoveNext() override {
+    uint64_t now = ReadTicks();
+    CloseEvent(now);
+    if (!m_running) {
+      m_running = true;
+      m_bucketTicks = std::max<uint64_t>(1, static_cast<uint64_t>(m_timelineInterval / CalibrateSecondsPerTick()));
+      m_startClock = std::chrono::steady_clock::now();
+      now = m_startTicks = ReadTicks();
+    }
+    Event next = m_scheduler->RemoveNext();
+    const LabelledEvent *labelled = dynamic_cast<const LabelledEvent *>(next.impl);
+    m_currentLabel = labelled != nullptr ? labelled->GetLabel() : nullptr;
+    m_current = &typeid(*next.impl);
+    m_currentContext = next.key.m_context;
+    m_eventStart = now;
+    m_eventEnd = now;
+    m_events++;
+    RecordTimeline(now, next.key.m_ts);
+    return next;
+  }
+
+  void Remove(const Event &ev) override { m_scheduler->Remove(ev); }
+
+  // Flat profile of the run so far, top `topN` event types and nodes.
+  void Print(std::ostream &os, uint32_t topN = 20) {
+    CloseEvent(m_eventEnd);
+    double secondsPerTick = GetSecondsPerTick();
+
+    // Identical types can show up under several type_info objects when they
+    // come from different shared libraries.
+    std::map<std::string, Stat> byName;
+    for (const auto &t : m_types) {
+      Stat &s = byName[Demangle(t.first->name())];
+      s.count += t.second.count;
+      s.ticks += t.second.ticks;
+    }
+    for (const auto &l : m_labels) {
+      Stat &s = byName[l.first];
+      s.count += l.second.count;
+      s.ticks += l.second.ticks;
+    }
+    std::vector<std::pair<std::string, Stat>> types(byName.begin(), byName.end());
+
+    std::vector<std::pair<std::string, Stat>> nodes;
+    for (const auto &n : m_nodes) {
+      nodes.push_back(std::make_pair(n.first == Simulator::NO_CONTEXT ? std::string("(none)")
+                                                                      : "node " + std::to_string(n.first),
+                                     n.second));
+    }
+
+    uint64_t totalTicks = 0;
+    for (const auto &t : types) {
+      totalTicks += t.second.ticks;
+    }
+    double wall = (m_eventEnd - m_startTicks) * secondsPerTick;
+
+    os << "\n=== Event Profile ===\n"
+       << m_events << " events, " << totalTicks * secondsPerTick << " s in events, "
+       << wall << " s wall, " << (wall > 0 ? m_events / wall : 0.0) << " events/s\n";
+    PrintTable(os, "Event type", types, totalTicks, secondsPerTick, topN);
+    PrintTable(os, "Node", nodes, totalTicks, secondsPerTick, topN);
+
+    os << "\nTimeline (" << m_timelineInterval << " s buckets)\n"
+       << std::setw(10) << "wall s" << std::setw(12) << "events" << std::setw(14) << "events/s"
+       << std::setw(14) << "sim time s" << "\n";
+    for (uint32_t i = 0; i < m_timeline.size(); ++i) {
+      os << std::setw(10) << std::fixed << std::setprecision(1) << i * m_timelineInterval
+         << std::setw(12) << m_timeline[i].events
+         << std::setw(14) << std::setprecision(0) << m_timeline[i].events / m_timelineInterval
+         << std::setw(14) << std::setprecision(1) << TimeStep(m_timeline[i].simTicks).GetSeconds()
+         << "\n";
+    }
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+  }
+
+  // The profiler installed by EnableEventProfiler, if the simulator still has it.
+  static ProfilingScheduler *Get() { return Instance(); }
+
+private:
+  struct Stat {
+    Stat() : count(0), ticks(0) {}
+    uint64_t count;
+    uint64_t ticks;
+  };
+
+  struct Bucket {
+    Bucket() : events(0), simTicks(0) {}
+    uint64_t events;
+    uint64_t simTicks;  // simulation time reached by the end of the bucket
+  };
+
+  void SetSchedulerType(std::string type) {
+    ObjectFactory factory;
+    factory.SetTypeId(type);
+    Ptr<Scheduler> scheduler = factory.Create<Scheduler>();
+    while (m_scheduler != nullptr && !m_scheduler->IsEmpty()) {
+      scheduler->Insert(m_scheduler->RemoveNext());
+    }
+    m_scheduler = scheduler;
+  }
+
+  static uint64_t ReadTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  // Rate over the whole run, for the totals
+  double GetSecondsPerTick() const {
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ticks = ReadTicks() - m_startTicks;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startClock).count();
+    return m_running && ticks > 0 ? seconds / ticks : CalibrateSecondsPerTick();
+#else
+    return 1e-9;
+#endif
+  }
+
+  // Short spin at the start of the run, to size the timeline buckets
+  static double CalibrateSecondsPerTick() {
+#if defined(__x86_64__) || defined(__i386__)
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t startTicks = ReadTicks();
+    std::chrono::steady_clock::time_point now;
+    do {
+      now = std::chrono::steady_clock::now();
+    } while (now - start < std::chrono::milliseconds(10));
+    return std::chrono::duration<double>(now - start).count() / (ReadTicks() - startTicks);
+#else
+    return 1e-9;
+#endif
+  }
+
+  void CloseEvent(uint64_t now) {
+    if (m_current == nullptr) {
+      return;
+    }
+    uint64_t ticks = std::min(m_eventEnd, now) - m_eventStart;
+    Stat &type = m_currentLabel != nullptr ? m_labels[m_currentLabel] : m_types[m_current];
+    type.count++;
+    type.ticks += ticks;
+    Stat &node = m_nodes[m_currentContext];
+    node.count++;
+    node.ticks += ticks;
+    m_current = nullptr;
+  }
+
+  void RecordTimeline(uint64_t now, uint64_t simTicks) {
+    std::size_t bucket = (now - m_startTicks) / m_bucketTicks;
+    if (bucket >= m_timeline.size()) {
+      m_timeline.resize(bucket + 1);
+    }
+    m_timeline[bucket].events++;
+    m_timeline[bucket].simTicks = simTicks;
+  }
+
+  static std::string Demangle(const char *name) {
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    std::string result = status == 0 && demangled != nullptr ? demangled : name;
+    std::free(demangled);
+    return result;
+  }
+
+  static void PrintTable(std::ostream &os, const std::string &title,
+                         std::vector<std::pair<std::string, Stat>> &rows,
+                         uint64_t totalTicks, double secondsPerTick, uint32_t topN) {
+    std::sort(rows.begin(), rows.end(),
+              [](const std::pair<std::string, Stat> &a, const std::pair<std::string, Stat> &b) {
+                return a.second.ticks > b.second.ticks;
+              });
+    os << "\n" << std::setw(8) << "% time" << std::setw(12) << "seconds"
+       << std::setw(12) << "events" << std::setw(10) << "ns/event" << "  " << title << "\n";
+    for (uint32_t i = 0; i < rows.size() && i < topN; ++i) {
+      const Stat &s = rows[i].second;
+      os << std::fixed << std::setprecision(1)
+         << std::setw(8) << (totalTicks > 0 ? 100.0 * s.ticks / totalTicks : 0.0)
+         << std::setw(12) << std::setprecision(3) << s.ticks * secondsPerTick
+         << std::setw(12) << s.count
+         << std::setw(10) << std::setprecision(0) << (s.count > 0 ? 1e9 * s.ticks * secondsPerTick / s.count : 0.0)
+         << "  " << rows[i].first << "\n";
+    }
+    if (rows.size() > topN) {
+      os << "  ... " << rows.size() - topN << " more\n";
+    }
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+  }
+
+  Ptr<Scheduler> m_scheduler;
+  double m_timelineInterval;
+
+  bool m_running;
+  uint64_t m_eventStart;
+  mutable uint64_t m_eventEnd;
+  const std::type_info *m_current;
+  const char *m_currentLabel;
+  uint32_t m_currentContext;
+
+  uint64_t m_startTicks;
+  std::chrono::steady_clock::time_point m_startClock;
+  uint64_t m_bucketTicks;
+  uint64_t m_events;
+
+  std::unordered_map<const std::type_info *, Stat> m_types;
+  std::unordered_map<const char *, Stat> m_labels;  // by label address; Print merges equal strings
+  std::unordered_map<uint32_t, Stat> m_nodes;
+  std::vector<Bucket> m_timeline;
+
+  // Function-local so the header can be included by several translation units
+  static ProfilingScheduler *&Instance() {
+    static ProfilingScheduler *instance = nullptr;
+    return instance;
+  }
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ProfilingScheduler);
+
+// Swaps the simulator's scheduler for the profiler; events already scheduled
+// are carried over. Call before Simulator::Run().
+inline void EnableEventProfiler(double timelineInterval = 1.0) {
+  ObjectFactory factory("ns3::ProfilingScheduler");
+  factory.Set("TimelineInterval", DoubleValue(timelineInterval));
+  Simulator::SetScheduler(factory);
+}
+
+// Prints the profile if EnableEventProfiler was called. Call after
+// Simulator::Run() and before Simulator::Destroy().
+inline void PrintEventProfile(std::ostream &os, uint32_t topN = 20) {
+  if (ProfilingScheduler::Get() != nullptr) {
+    ProfilingScheduler::Get()->Print(os, topN);
+  }
+}
+
+} // namespace ns3
+
+#endif /* EVENT_PROFILER_H */
@@ -0,0 +1,393 @@
+#ifndef FIX_INTEGRITY_H
+#define FIX_INTEGRITY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FIX_INTEGRITY_AVX2 1
+#endif
+
+namespace ns3 {
+
+// ==================== FIX INTEGRITY ====================
+// Tamper evidence for the fixes a device buffers between syncs. Each sync
+// batch is sealed with SipHash-2-4 under a per-device key, and the MAC
+// covers the previous batch's tag and the batch sequence number, so
+// editing, dropping, reordering or replaying a batch all break the chain.
+// The device pays one MAC per batch instead of one per fix.
+//
+// On the ingest side BatchVerifier checks many devices' batches at once:
+// equal-length batches are hashed four at a time, one per 64-bit lane of
+// an AVX2 register. The AVX2 code is compiled in with a target attribute
+// and picked at run time, so it needs no -mavx2 in the ns-3 build; CPUs
+// without AVX2 (and non-x86 builds) hash one batch at a time.
+
+// One fix as buffered on the device, little-endian.
+const std::size_t FIX_RECORD_BYTES = 24;
+
+inline void AppendFixRecord(std::vector<uint8_t> &buffer, uint32_t device, uint32_t sequence,
+                            int64_t timeMs, int32_t xCm, int32_t yCm) {
+  uint8_t record[FIX_RECORD_BYTES];
+  std::memcpy(record, &device, 4);
+  std::memcpy(record + 4, &sequence, 4);
+  std::memcpy(record + 8, &timeMs, 8);
+  std::memcpy(record + 16, &xCm, 4);
+  std::memcpy(record + 20, &yCm, 4);
+  buffer.insert(buffer.end(), record, record + sizeof(record));
+}
+
+// SipHash-2-4 over (w0, w1, message): the two leading words carry the chain
+// state without copying the batch behind them.
+class SipHash {
+public:
+  static uint64_t Hash(uint64_t k0, uint64_t k1, uint64_t w0, uint64_t w1,
+                       const uint8_t *message, std::size_t length) {
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    Compress(v0, v1, v2, v3, w0);
+    Compress(v0, v1, v2, v3, w1);
+    std::size_t blocks = length / 8;
+    for (std::size_t i = 0; i < blocks; ++i) {
+      Compress(v0, v1, v2, v3, Load(message + 8 * i));
+    }
+    Compress(v0, v1, v2, v3, LastBlock(message + 8 * blocks, length));
+    return Finalise(v0, v1, v2, v3);
+  }
+
+#if defined(FIX_INTEGRITY_AVX2)
+  static const std::size_t AVX2_LANES = 4;
+
+  // Same as Hash for four independent messages of equal length. Only call
+  // when the CPU has AVX2 (BatchVerifier::GetLanes).
+  __attribute__((target("avx2")))
+  static void HashLanesAvx2(const uint64_t *k0, const uint64_t *k1, const uint64_t *w0,
+                            const uint64_t *w1, const uint8_t *const *messages,
+                            std::size_t length, uint64_t *out) {
+    __m256i key0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(k0));
+    __m256i key1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(k1));
+    __m256i v0 = _mm256_xor_si256(key0, _mm256_set1_epi64x(0x736f6d6570736575LL));
+    __m256i v1 = _mm256_xor_si256(key1, _mm256_set1_epi64x(0x646f72616e646f6dLL));
+    __m256i v2 = _mm256_xor_si256(key0, _mm256_set1_epi64x(0x6c7967656e657261LL));
+    __m256i v3 = _mm256_xor_si256(key1, _mm256_set1_epi64x(0x7465646279746573LL));
+    CompressAvx2(v0, v1, v2, v3, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w0)));
+    CompressAvx2(v0, v1, v2, v3, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w1)));
+    std::size_t blocks = length / 8;
+    for (std::size_t i = 0; i < blocks; ++i) {
+      CompressAvx2(v0, v1, v2, v3,
+                   _mm256_set_epi64x(Load(messages[3] + 8 * i), Load(messages[2] + 8 * i),
+                                     Load(messages[1] + 8 * i), Load(messages[0] + 8 * i)));
+    }
+    CompressAvx2(v0, v1, v2, v3,
+                 _mm256_set_epi64x(LastBlock(messages[3] + 8 * blocks, length),
+                                   LastBlock(messages[2] + 8 * blocks, length),
+                                   LastBlock(messages[1] + 8 * blocks, length),
+                                   LastBlock(messages[0] + 8 * blocks, length)));
+    v2 = _mm256_xor_si256(v2, _mm256_set1_epi64x(0xff));
+    for (int r = 0; r < 4; ++r) {
+      RoundAvx2(v0, v1, v2, v3);
+    }
+    __m256i tag = _mm256_xor_si256(_mm256_xor_si256(v0, v1), _mm256_xor_si256(v2, v3));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), tag);
+  }
+#endif
+
+private:
+  static uint64_t Rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+  static uint64_t Load(const uint8_t *p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+  }
+
+  // Trailing bytes plus the total length (including the two chain words)
+  static uint64_t LastBlock(const uint8_t *tail, std::size_t length) {
+    uint64_t b = static_cast<uint64_t>(length + 16) << 56;
+    for (std::size_t j = 0; j < length % 8; ++j) {
+      b |= static_cast<uint64_t>(tail[j]) << (8 * j);
+    }
+    return b;
+  }
+
+  static void Round(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3) {
+    v0 += v1; v1 = Rotl(v1, 13); v1 ^= v0; v0 = Rotl(v0, 32);
+    v2 += v3; v3 = Rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = Rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = Rotl(v1, 17); v1 ^= v2; v2 = Rotl(v2, 32);
+  }
+
+  static void Compress(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3, uint64_t m) {
+    v3 ^= m;
+    Round(v0, v1, v2, v3);
+    Round(v0, v1, v2, v3);
+    v0 ^= m;
+  }
+
+  static uint64_t Finalise(uint64_t v0, uint64_t v1, uint64_t v2, uint64_t v3) {
+    v2 ^= 0xff;
+    for (int r = 0; r < 4; ++r) {
+      Round(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+  }
+
+#if defined(FIX_INTEGRITY_AVX2)
+  template <int B>
+  __attribute__((target("avx2")))
+  static __m256i RotlAvx2(__m256i x) {
+    return _mm256_or_si256(_mm256_slli_epi64(x, B), _mm256_srli_epi64(x, 64 - B));
+  }
+
+  __attribute__((target("avx2")))
+  static void RoundAvx2(__m256i &v0, __m256i &v1, __m256i &v2, __m256i &v3) {
+    v0 = _mm256_add_epi64(v0, v1); v1 = RotlAvx2<13>(v1); v1 = _mm256_xor_si256(v1, v0);
+    v0 = RotlAvx2<32>(v0);
+    v2 = _mm256_add_epi64(v2, v3); v3 = RotlAvx2<16>(v3); v3 = _mm256_xor_si256(v3, v2);
+    v0 = _mm256_add_epi64(v0, v3); v3 = RotlAvx2<21>(v3); v3 = _mm256_xor_si256(v3, v0);
+    v2 = _mm256_add_epi64(v2, v1); v1 = RotlAvx2<17>(v1); v1 = _mm256_xor_si256(v1, v2);
+    v2 = RotlAvx2<32>(v2);
+  }
+
+  __attribute__((target("avx2")))
+  static void CompressAvx2(__m256i &v0, __m256i &v1, __m256i &v2, __m256i &v3, __m256i m) {
+    v3 = _mm256_xor_si256(v3, m);
+    RoundAvx2(v0, v1, v2, v3);
+    RoundAvx2(v0, v1, v2, v3);
+    v0 = _mm256_xor_si256(v0, m);
+  }
+#endif
+};
+
+struct DeviceKey {
+  uint64_t k0;
+  uint64_t k1;
+};
+
+// Per-device key provisioned from a fleet master key
+inline DeviceKey DeriveDeviceKey(const DeviceKey &master, uint32_t device) {
+  DeviceKey key = {SipHash::Hash(master.k0, master.k1, device, 0, nullptr, 0),
+                   SipHash::Hash(master.k0, master.k1, device, 1, nullptr, 0)};
+  return key;
+}
+
+struct SealedBatch {
+  uint32_t device;
+  uint64_t sequence;
+  uint64_t tag;
+  std::vector<uint8_t> payload;
+};
+
+// ==================== DEVICE SIDE ====================
+class FixBatchSealer {
+public:
+  FixBatchSealer(uint32_t device, const DeviceKey &key)
+    : m_device(device), m_key(key), m_fixes(0), m_sequence(0), m_previousTag(0) {}
+
+  void Record(int64_t timeMs, int32_t xCm, int32_t yCm) {
+    AppendFixRecord(m_buffer, m_device, m_fixes++, timeMs, xCm, yCm);
+  }
+
+  std::size_t GetBufferedBytes() const { return m_buffer.size(); }
+
+  // Seals everything buffered since the last sync and starts a new batch.
+  SealedBatch Seal() {
+    SealedBatch batch;
+    batch.device = m_device;
+    batch.sequence = m_sequence++;
+    batch.tag = SipHash::Hash(m_key.k0, m_key.k1, m_previousTag, batch.sequence,
+                              m_buffer.data(), m_buffer.size());
+    batch.payload.swap(m_buffer);
+    m_buffer.reserve(batch.payload.size());
+    m_previousTag = batch.tag;
+    return batch;
+  }
+
+private:
+  uint32_t m_device;
+  DeviceKey m_key;
+  uint32_t m_fixes;
+  uint64_t m_sequence;
+  uint64_t m_previousTag;
+  std::vector<uint8_t> m_buffer;
+};
+
+// MCU cost of sealing, in the scenario's charge unit (current unit x s).
+struct SealCostModel {
+  double cyclesPerByte;   // SipHash on the device MCU, per message byte
+  double overheadCycles;  // init, finalisation, storing the tag
+  double clockHz;
+  double activeCurrent;   // MCU run current, same unit as the battery
+
+  double Charge(std::size_t bytes) const {
+    double cycles = overheadCycles + cyclesPerByte * (bytes + 16);
+    return cycles / clockHz * activeCurrent;
+  }
+};
+
+// ==================== INGEST SIDE ====================
+class BatchVerifier {
+public:
+  // Batches hashed together: four on CPUs with AVX2, otherwise one.
+  static std::size_t GetLanes() {
+#if defined(FIX_INTEGRITY_AVX2)
+    static const std::size_t lanes = __builtin_cpu_supports("avx2") ? SipHash::AVX2_LANES : 1;
+    return lanes;
+#else
+    return 1;
+#endif
+  }
+
+  explicit BatchVerifier(const DeviceKey &master)
+    : m_master(master), m_epoch(0), m_verified(0), m_rejected(0), m_verifiedBytes(0) {}
+
+  // Verifies `batches` (any mix of devices, a device's batches in order)
+  // and advances each device's chain past the ones that verify. A batch
+  // after a rejected one from the same device is rejected too, and so is
+  // everything that device sends afterwards: a broken chain is the
+  // evidence. Returns the number rejected; `accepted`, if given, gets one
+  // flag per batch.
+  std::size_t Verify(const std::vector<SealedBatch> &batches,
+                     std::vector<bool> *accepted = nullptr) {
+    const std::size_t n = batches.size();
+    m_epoch++;
+    m_batchChains.resize(n);
+    m_k0.resize(n);
+    m_k1.resize(n);
+    m_w0.resize(n);
+    m_w1.resize(n);
+    m_tags.resize(n);
+    m_order.resize(n);
+    bool sameLength = true;
+    for (std::size_t i = 0; i < n; ++i) {
+      Chain *chain = &GetChain(batches[i].device);
+      m_batchChains[i] = chain;
+      m_k0[i] = chain->key.k0;
+      m_k1[i] = chain->key.k1;
+      // A device's later batches in the same call chain off the earlier ones
+      if (chain->epoch == m_epoch) {
+        m_w0[i] = chain->pendingTag;
+        m_w1[i] = chain->pendingSequence + 1;
+      } else {
+        m_w0[i] = chain->previousTag;
+        m_w1[i] = chain->nextSequence;
+        chain->epoch = m_epoch;
+      }
+      chain->pendingTag = batches[i].tag;
+      chain->pendingSequence = m_w1[i];
+      m_order[i] = i;
+      sameLength = sameLength && batches[i].payload.size() == batches[0].payload.size();
+    }
+
+    // Group equal lengths so whole groups of lanes run together
+    if (!sameLength) {
+      std::stable_sort(m_order.begin(), m_order.end(), [&batches](std::size_t a, std::size_t b) {
+        return batches[a].payload.size() < batches[b].payload.size();
+      });
+    }
+#if defined(FIX_INTEGRITY_AVX2)
+    const std::size_t lanes = GetLanes();
+#endif
+    std::size_t i = 0;
+    while (i < n) {
+      std::size_t length = batches[m_order[i]].payload.size();
+      std::size_t end = i;
+      while (end < n && batches[m_order[end]].payload.size() == length) {
+        end++;
+      }
+#if defined(FIX_INTEGRITY_AVX2)
+      for (; lanes > 1 && i + lanes <= end; i += lanes) {
+        const std::size_t width = SipHash::AVX2_LANES;
+        uint64_t k0[width], k1[width], w0[width], w1[width], tags[width];
+        const uint8_t *messages[width];
+        for (std::size_t l = 0; l < width; ++l) {
+          std::size_t b = m_order[i + l];
+          k0[l] = m_k0[b];
+          k1[l] = m_k1[b];
+          w0[l] = m_w0[b];
+          w1[l] = m_w1[b];
+          messages[l] = batches[b].payload.data();
+        }
+        SipHash::HashLanesAvx2(k0, k1, w0, w1, messages, length, tags);
+        for (std::size_t l = 0; l < width; ++l) {
+          m_tags[m_order[i + l]] = tags[l];
+        }
+      }
+#endif
+      for (; i < end; ++i) {
+        std::size_t b = m_order[i];
+        m_tags[b] = SipHash::Hash(m_k0[b], m_k1[b], m_w0[b], m_w1[b],
+                                  batches[b].payload.data(), length);
+      }
+    }
+
+    // Commit in arrival order so a break stops the device's chain
+    std::size_t rejected = 0;
+    if (accepted != nullptr) {
+      accepted->assign(n, false);
+    }
+    for (std::size_t b = 0; b < n; ++b) {
+      Chain &chain = *m_batchChains[b];
+      bool ok = m_tags[b] == batches[b].tag && m_w0[b] == chain.previousTag
+                && m_w1[b] == chain.nextSequence;
+      if (ok) {
+        chain.previousTag = batches[b].tag;
+        chain.nextSequence++;
+        m_verifiedBytes += batches[b].payload.size();
+      } else {
+        rejected++;
+      }
+      if (accepted != nullptr) {
+        (*accepted)[b] = ok;
+      }
+    }
+    m_verified += n - rejected;
+    m_rejected += rejected;
+    return rejected;
+  }
+
+  uint64_t GetVerified() const { return m_verified; }
+  uint64_t GetRejected() const { return m_rejected; }
+  uint64_t GetVerifiedBytes() const { return m_verifiedBytes; }
+
+private:
+  struct Chain {
+    DeviceKey key;
+    uint64_t previousTag;
+    uint64_t nextSequence;
+    // Claimed by batches of the Verify call numbered `epoch`
+    uint64_t epoch;
+    uint64_t pendingTag;
+    uint64_t pendingSequence;
+  };
+
+  Chain &GetChain(uint32_t device) {
+    auto found = m_chains.find(device);
+    if (found != m_chains.end()) {
+      return found->second;
+    }
+    Chain chain = {DeriveDeviceKey(m_master, device), 0, 0, 0, 0, 0};
+    return m_chains.emplace(device, chain).first->second;
+  }
+
+  DeviceKey m_master;
+  std::unordered_map<uint32_t, Chain> m_chains;
+  uint64_t m_epoch;
+  std::vector<Chain *> m_batchChains;
+  std::vector<uint64_t> m_k0, m_k1, m_w0, m_w1, m_tags;
+  std::vector<std::size_t> m_order;
+  uint64_t m_verified;
+  uint64_t m_rejected;
+  uint64_t m_verifiedBytes;
+};
+
+} // namespace ns3
+
+#endif /* FIX_INTEGRITY_H */
@@ -0,0 +1,184 @@
+#ifndef FRAME_DEDUP_H
+#define FRAME_DEDUP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== DUPLICATE FILTER ====================
+// Network-server side duplicate elimination. Every gateway that hears a
+// frame forwards it; the first copy of (device, sequence number) is
+// delivered and later copies within the reception window are dropped.
+//
+// Frames are kept in two open-addressing tables of packed 64-bit keys, the
+// current and the previous generation, rotated once per window: a frame is
+// remembered for between one and two windows, and expiry costs one pass over
+// the old table instead of a timer or a list node per frame. Lookups probe
+// both tables, linearly from a multiplicative hash.
+//
+// Each entry also records the lowest gateway index that heard the frame.
+// When it expires that goes into a histogram, so one run tells how many
+// frames the first k gateways alone would have delivered, for every k.
+//
+// Times are integer ticks (e.g. ns-3 Time::GetTimeStep()).
+class DuplicateFilter {
+public:
+  DuplicateFilter(int64_t window, uint32_t gateways)
+    : m_window(window),
+      m_generationStart(0),
+      m_receptions(0),
+      m_duplicates(0),
+      m_receptionsPerGateway(gateways, 0),
+      m_bestGateway(gateways, 0) {
+    m_tables[0].Reset(MIN_CAPACITY);
+    m_tables[1].Reset(MIN_CAPACITY);
+  }
+
+  // Returns true if this is the first copy of the frame, i.e. it should be
+  // delivered to the application.
+  bool Receive(uint32_t device, uint32_t sequence, uint16_t gateway, int64_t now) {
+    Advance(now);
+    m_receptions++;
+    m_receptionsPerGateway[gateway]++;
+    uint64_t key = (static_cast<uint64_t>(device) << 32) | sequence;
+    for (Table &table : m_tables) {
+      Slot *slot = table.Find(key);
+      if (slot != nullptr) {
+        slot->bestGateway = std::min(slot->bestGateway, gateway);
+        m_duplicates++;
+        return false;
+      }
+    }
+    Table &current = m_tables[CURRENT];
+    if (2 * (current.size + 1) > current.slots.size()) {
+      current.Grow();
+    }
+    current.Insert(key, gateway);
+    return true;
+  }
+
+  // Expires everything still held, e.g. at the end of the run.
+  void Flush() {
+    Rotate();
+    Rotate();
+  }
+
+  uint64_t GetReceptions() const { return m_receptions; }
+  uint64_t GetDuplicates() const { return m_duplicates; }
+  uint64_t GetUnique() const { return m_receptions - m_duplicates; }
+
+  // Copies forwarded by each gateway.
+  const std::vector<uint64_t> &GetReceptionsPerGateway() const { return m_receptionsPerGateway; }
+
+  // Expired frames by the lowest gateway index that heard them.
+  const std::vector<uint64_t> &GetBestGateway() const { return m_bestGateway; }
+
+  std::size_t GetTableBytes() const {
+    return (m_tables[0].slots.size() + m_tables[1].slots.size()) * sizeof(Slot);
+  }
+
+private:
+  static const uint32_t MIN_CAPACITY = 1024;  // power of two
+  static const uint64_t EMPTY = ~0ULL;        // device and sequence 0xffffffff
+  enum { CURRENT, PREVIOUS };
+
+  struct Slot {
+    uint64_t key;
+    uint16_t bestGateway;
+  };
+
+  struct Table {
+    std::vector<Slot> slots;
+    uint32_t size;
+    int shift;
+
+    void Reset(std::size_t capacity) {
+      slots.assign(capacity, Slot{EMPTY, 0});
+      size = 0;
+      shift = 64;
+      for (std::size_t c = capacity; c > 1; c >>= 1) {
+        shift--;
+      }
+    }
+
+    std::size_t Home(uint64_t key) const {
+      return static_cast<std::size_t>((key * 0x9e3779b97f4a7c15ULL) >> shift);
+    }
+
+    Slot *Find(uint64_t key) {
+      std::size_t mask = slots.size() - 1;
+      for (std::size_t i = Home(key);; i = (i + 1) & mask) {
+        if (slots[i].key == key) {
+          return &slots[i];
+        }
+        if (slots[i].key == EMPTY) {
+          return nullptr;
+        }
+      }
+    }
+
+    void Insert(uint64_t key, uint16_t gateway) {
+      std::size_t mask = slots.size() - 1;
+      std::size_t i = Home(key);
+      while (slots[i].key != EMPTY) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = Slot{key, gateway};
+      size++;
+    }
+
+    void Grow() {
+      std::vector<Slot> old;
+      old.swap(slots);
+      Reset(old.size() * 2);
+      for (const Slot &s : old) {
+        if (s.key != EMPTY) {
+          Insert(s.key, s.bestGateway);
+        }
+      }
+    }
+  };
+
+  void Advance(int64_t now) {
+    if (now - m_generationStart < m_window) {
+      return;
+    }
+    // Anything older than two windows is gone either way
+    Rotate();
+    if (now - m_generationStart >= 2 * m_window) {
+      Rotate();
+    }
+    m_generationStart = now;
+  }
+
+  // Drops the previous generation (recording where its frames were first
+  // heard) and starts an empty current one, sized for the last window's load.
+  void Rotate() {
+    Table &expired = m_tables[PREVIOUS];
+    for (const Slot &s : expired.slots) {
+      if (s.key != EMPTY) {
+        m_bestGateway[s.bestGateway]++;
+      }
+    }
+    std::size_t capacity = MIN_CAPACITY;
+    while (capacity < 2 * m_tables[CURRENT].size) {
+      capacity *= 2;
+    }
+    std::swap(m_tables[CURRENT], m_tables[PREVIOUS]);
+    m_tables[CURRENT].Reset(capacity);
+  }
+
+  int64_t m_window;
+  int64_t m_generationStart;
+  Table m_tables[2];
+  uint64_t m_receptions;
+  uint64_t m_duplicates;
+  std::vector<uint64_t> m_receptionsPerGateway;
+  std::vector<uint64_t> m_bestGateway;
+};
+
+} // namespace ns3
+
+#endif /* FRAME_DEDUP_H */
@@ -0,0 +1,441 @@
+#ifndef GPS_ENERGY_MODEL_H
+#define GPS_ENERGY_MODEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-model.h"
+#include "ns3/device-energy-model.h"
+#include "ns3/energy-source.h"
+#include "event_profiler.h"
+#include "distance_stats.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== GPS ENERGY MODEL ====================
+// GNSS receiver duty-cycled between fixes: asleep with RTC and backup RAM
+// kept alive, acquiring satellites after a wake-up, and tracking once it has
+// a fix. How long acquisition takes depends on what survived the sleep:
+// valid ephemeris gives a hot start, only the almanac a warm start, nothing
+// (or no fix yet) a cold start. Defaults are typical of a u-blox M8 class
+// receiver at 3 V.
+class GpsReceiverEnergyModel : public DeviceEnergyModel {
+public:
+  enum State {
+    ACQUISITION = 0,  // searching for satellites, no fix yet
+    TRACKING,         // fix available, receiver kept running
+    SLEEP,            // backup mode, RTC and ephemeris retained
+    NUM_STATES
+  };
+
+  enum StartType {
+    HOT = 0,  // ephemeris still valid
+    WARM,     // almanac and time valid, ephemeris must be downloaded
+    COLD,     // nothing usable, full sky search
+    NUM_START_TYPES
+  };
+
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::GpsReceiverEnergyModel")
+      .SetParent<DeviceEnergyModel>()
+      .AddConstructor<GpsReceiverEnergyModel>()
+      .AddAttribute("AcquisitionCurrentA", "Current draw while acquiring satellites.",
+                    DoubleValue(0.029),
+                    MakeDoubleAccessor(&GpsReceiverEnergyModel::m_acquisitionCurrentA),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("TrackingCurrentA", "Current draw while tracking with a fix.",
+                    DoubleValue(0.023),
+                    MakeDoubleAccessor(&GpsReceiverEnergyModel::m_trackingCurrentA),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("SleepCurrentA", "Current draw in backup mode between fixes.",
+                    DoubleValue(0.000015),
+                    MakeDoubleAccessor(&GpsReceiverEnergyModel::m_sleepCurrentA),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("HotStartTime", "Time to first fix with valid ephemeris.",
+                    TimeValue(Seconds(1)),
+                    MakeTimeAccessor(&GpsReceiverEnergyModel::m_hotStartTime),
+                    MakeTimeChecker())
+      .AddAttribute("WarmStartTime", "Time to first fix with almanac but expired ephemeris.",
+                    TimeValue(Seconds(25)),
+                    MakeTimeAccessor(&GpsReceiverEnergyModel::m_warmStartTime),
+                    MakeTimeChecker())
+      .AddAttribute("ColdStartTime", "Time to first fix with no assistance data.",
+                    TimeValue(Seconds(30)),
+                    MakeTimeAccessor(&GpsReceiverEnergyModel::m_coldStartTime),
+                    MakeTimeChecker())
+      .AddAttribute("EphemerisValidity", "Longest gap since the last fix that still allows a hot start.",
+                    TimeValue(Hours(2)),
+                    MakeTimeAccessor(&GpsReceiverEnergyModel::m_ephemerisValidity),
+                    MakeTimeChecker())
+      .AddAttribute("AlmanacValidity", "Longest gap since the last fix that still allows a warm start.",
+                    TimeValue(Days(30)),
+                    MakeTimeAccessor(&GpsReceiverEnergyModel::m_almanacValidity),
+                    MakeTimeChecker())
+      .AddTraceSource("TotalEnergyConsumption", "Total energy consumed by the receiver.",
+                      MakeTraceSourceAccessor(&GpsReceiverEnergyModel::m_totalEnergyConsumption),
+                      "ns3::TracedValueCallback::Double")
+      .AddTraceSource("State", "Receiver state changes (old, new).",
+                      MakeTraceSourceAccessor(&GpsReceiverEnergyModel::m_stateTrace),
+                      "ns3::GpsReceiverEnergyModel::StateTracedCallback");
+    return tid;
+  }
+
+  typedef void (*StateTracedCallback)(int oldState, int newState);
+
+  GpsReceiverEnergyModel()
+    : m_state(SLEEP),
+      m_lastUpdateTime(Seconds(0)),
+      m_hasFix(false),
+      m_depleted(false) {
+    m_totalEnergyConsumption = 0;
+    m_residency.fill(Seconds(0));
+    m_starts.fill(0);
+  }
+
+  void SetEnergySource(Ptr<EnergySource> source) override {
+    NS_ASSERT(source != nullptr);
+    m_source = source;
+  }
+
+  double GetTotalEnergyConsumption() const override {
+    return m_totalEnergyConsumption;
+  }
+
+  void ChangeState(int newState) override {
+    NS_ASSERT(newState >= 0 && newState < NUM_STATES);
+    Accumulate();
+    if (m_source != nullptr) {
+      m_source->UpdateEnergySource();
+    }
+    int oldState = m_state;
+    m_state = static_cast<State>(newState);
+    m_stateTrace(oldState, newState);
+  }
+
+  void HandleEnergyDepletion() override {
+    m_depleted = true;
+  }
+
+  void HandleEnergyRecharged() override {
+    m_depleted = false;
+  }
+
+  void HandleEnergyChanged() override {}
+
+  // Wakes the receiver and returns how long until it has a fix.
+  Time BeginAcquisition() {
+    StartType type = GetStartType(Simulator::Now());
+    m_starts[type]++;
+    ChangeState(ACQUISITION);
+    return GetTimeToFirstFix(type);
+  }
+
+  // Called once the receiver has a position; it stays in TRACKING until
+  // told to sleep.
+  void NotifyFix() {
+    ChangeState(TRACKING);
+    m_lastFixTime = Simulator::Now();
+    m_hasFix = true;
+  }
+
+  // Start type the receiver would get if it woke up at `at`.
+  StartType GetStartType(Time at) const {
+    if (!m_hasFix) {
+      return COLD;
+    }
+    Time age = at - m_lastFixTime;
+    if (age <= m_ephemerisValidity) {
+      return HOT;
+    }
+    return age <= m_almanacValidity ? WARM : COLD;
+  }
+
+  Time GetTimeToFirstFix(StartType type) const {
+    switch (type) {
+      case HOT: return m_hotStartTime;
+      case WARM: return m_warmStartTime;
+      default: return m_coldStartTime;
+    }
+  }
+
+  // Whether staying in TRACKING for `gap` costs less than sleeping and
+  // paying for a restart at the end of it.
+  bool ShouldStayOn(Time gap) const {
+    Time ttff = GetTimeToFirstFix(GetStartType(Simulator::Now() + gap));
+    double stay = gap.GetSeconds() * m_trackingCurrentA;
+    double cycle = std::max(gap - ttff, Seconds(0)).GetSeconds() * m_sleepCurrentA
+                   + ttff.GetSeconds() * m_acquisitionCurrentA;
+    return stay <= cycle;
+  }
+
+  State GetState() const { return m_state; }
+  bool IsDepleted() const { return m_depleted; }
+  uint32_t GetStarts(StartType type) const { return m_starts[type]; }
+
+  double GetStateCurrentA(int state) const {
+    switch (state) {
+      case ACQUISITION: return m_acquisitionCurrentA;
+      case TRACKING: return m_trackingCurrentA;
+      default: return m_sleepCurrentA;
+    }
+  }
+
+  // Time spent in the given state up to now.
+  Time GetResidency(State state) const {
+    Time residency = m_residency[state];
+    if (state == m_state) {
+      residency += Simulator::Now() - m_lastUpdateTime;
+    }
+    return residency;
+  }
+
+  static std::string GetStateName(int state) {
+    static const char *names[NUM_STATES] = {"ACQUISITION", "TRACKING", "SLEEP"};
+    return names[state];
+  }
+
+  static std::string GetStartTypeName(int type) {
+    static const char *names[NUM_START_TYPES] = {"HOT", "WARM", "COLD"};
+    return names[type];
+  }
+
+private:
+  double DoGetCurrentA() const override {
+    return GetStateCurrentA(m_state);
+  }
+
+  // Charges the energy spent in the current state since the last update.
+  void Accumulate() {
+    Time duration = Simulator::Now() - m_lastUpdateTime;
+    double voltage = m_source != nullptr ? m_source->GetSupplyVoltage() : 0.0;
+    m_totalEnergyConsumption += duration.GetSeconds() * GetStateCurrentA(m_state) * voltage;
+    m_residency[m_state] += duration;
+    m_lastUpdateTime = Simulator::Now();
+  }
+
+  Ptr<EnergySource> m_source;
+  State m_state;
+  double m_acquisitionCurrentA;
+  double m_trackingCurrentA;
+  double m_sleepCurrentA;
+  Time m_hotStartTime;
+  Time m_warmStartTime;
+  Time m_coldStartTime;
+  Time m_ephemerisValidity;
+  Time m_almanacValidity;
+  std::array<Time, NUM_STATES> m_residency;
+  std::array<uint32_t, NUM_START_TYPES> m_starts;
+  Time m_lastUpdateTime;
+  Time m_lastFixTime;
+  bool m_hasFix;
+  bool m_depleted;
+  TracedValue<double> m_totalEnergyConsumption;
+  TracedCallback<int, int> m_stateTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(GpsReceiverEnergyModel);
+
+// ==================== FIX SCHEDULER ====================
+// Takes fixes with a GpsReceiverEnergyModel on a vehicle following a mobility
+// model (the SUMO trace via Ns2MobilityHelper). In adaptive mode the next fix
+// is placed DistancePerFix metres ahead at the current speed, clamped to
+// [MinInterval, MaxInterval]; while the vehicle is stopped the interval
+// doubles per fix instead, so a traffic light costs a few short gaps and a
+// parked car quickly backs off to MaxInterval. With Adaptive=false it samples
+// every FixedInterval; its default equals MinInterval, the period a fixed
+// schedule needs to keep the same spacing up to 72 km/h, so adaptive can
+// never use more fixes than it. Set it to the adaptive mean interval for a
+// baseline with the same fix budget.
+//
+// The receiver is woken one predicted time-to-first-fix early so the fix
+// lands on schedule, and kept tracking instead when the gap is too short for
+// sleeping to pay off. Ground truth is audited every AuditInterval: the error
+// is the distance from the true position to the last fix, i.e. what a server
+// showing the latest report would be off by.
+class GpsFixScheduler : public Object {
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::GpsFixScheduler")
+      .SetParent<Object>()
+      .AddConstructor<GpsFixScheduler>()
+      .AddAttribute("Adaptive", "Adapt the fix interval to vehicle speed.",
+                    BooleanValue(true),
+                    MakeBooleanAccessor(&GpsFixScheduler::m_adaptive),
+                    MakeBooleanChecker())
+      .AddAttribute("FixedInterval", "Fix interval when not adaptive.",
+                    TimeValue(Seconds(5)),
+                    MakeTimeAccessor(&GpsFixScheduler::m_fixedInterval),
+                    MakeTimeChecker())
+      .AddAttribute("DistancePerFix", "Distance the vehicle should travel between adaptive fixes (m).",
+                    DoubleValue(100),
+                    MakeDoubleAccessor(&GpsFixScheduler::m_distancePerFix),
+                    MakeDoubleChecker<double>(0))
+      .AddAttribute("MinInterval", "Shortest adaptive fix interval.",
+                    TimeValue(Seconds(5)),
+                    MakeTimeAccessor(&GpsFixScheduler::m_minInterval),
+                    MakeTimeChecker())
+      .AddAttribute("MaxInterval", "Longest adaptive fix interval.",
+                    TimeValue(Seconds(300)),
+                    MakeTimeAccessor(&GpsFixScheduler::m_maxInterval),
+                    MakeTimeChecker())
+      .AddAttribute("StoppedSpeed", "Speed below which the vehicle counts as stopped (m/s).",
+                    DoubleValue(0.5),
+                    MakeDoubleAccessor(&GpsFixScheduler::m_stoppedSpeed),
+                    MakeDoubleChecker<double>(0))
+      .AddAttribute("HorizontalError", "Standard deviation of the fix error on each axis (m).",
+                    DoubleValue(2.0),
+                    MakeDoubleAccessor(&GpsFixScheduler::m_horizontalError),
+                    MakeDoubleChecker<double>(0))
+      .AddAttribute("AuditInterval", "How often the last fix is compared with the true position.",
+                    TimeValue(Seconds(1)),
+                    MakeTimeAccessor(&GpsFixScheduler::m_auditInterval),
+                    MakeTimeChecker())
+      .AddTraceSource("Fix", "A fix was taken (reported position, true position).",
+                      MakeTraceSourceAccessor(&GpsFixScheduler::m_fixTrace),
+                      "ns3::GpsFixScheduler::FixTracedCallback");
+    return tid;
+  }
+
+  typedef void (*FixTracedCallback)(const Vector &reported, const Vector &truth);
+
+  GpsFixScheduler()
+    : m_hasFix(false),
+      m_fixes(0) {
+    m_noise = CreateObject<NormalRandomVariable>();
+  }
+
+  void SetReceiver(Ptr<GpsReceiverEnergyModel> model) {
+    m_model = model;
+  }
+
+  void SetMobilityModel(Ptr<MobilityModel> mobility) {
+    m_mobility = mobility;
+  }
+
+  // Starts with the receiver asleep; the first fix is due at `at`.
+  void Start(Time at) {
+    m_noise->SetAttribute("Mean", DoubleValue(0));
+    m_noise->SetAttribute("Variance", DoubleValue(m_horizontalError * m_horizontalError));
+    m_model->ChangeState(GpsReceiverEnergyModel::SLEEP);
+    m_interval = m_adaptive ? m_minInterval : m_fixedInterval;
+    m_nextFix = Simulator::Now() + at;
+    ScheduleNextFix();
+    m_audit = ScheduleLabelled("GpsFixScheduler::Audit", at, &GpsFixScheduler::Audit, this);
+  }
+
+  int64_t AssignStreams(int64_t stream) {
+    m_noise->SetStream(stream);
+    return 1;
+  }
+
+  uint32_t GetFixes() const { return m_fixes; }
+  const DistanceStats &GetTrackingError() const { return m_trackingError; }
+  const DistanceStats &GetFixError() const { return m_fixError; }
+
+protected:
+  void DoDispose() override {
+    m_event.Cancel();
+    m_audit.Cancel();
+    m_model = nullptr;
+    m_mobility = nullptr;
+    Object::DoDispose();
+  }
+
+private:
+  // Either waits in TRACKING for the fix time or sleeps until it is time to
+  // start acquiring.
+  void ScheduleNextFix() {
+    Time now = Simulator::Now();
+    if (m_model->GetState() == GpsReceiverEnergyModel::TRACKING) {
+      m_event = ScheduleLabelled("GpsFixScheduler::TakeFix",
+                                 m_nextFix - now, &GpsFixScheduler::TakeFix, this);
+      return;
+    }
+    Time lead = m_model->GetTimeToFirstFix(m_model->GetStartType(m_nextFix));
+    Time wake = std::max(m_nextFix - lead, now);
+    m_event = ScheduleLabelled("GpsFixScheduler::Acquire", wake - now, &GpsFixScheduler::Acquire, this);
+  }
+
+  void Acquire() {
+    if (m_model->IsDepleted()) {
+      return;
+    }
+    Time ttff = m_model->BeginAcquisition();
+    m_event = ScheduleLabelled("GpsFixScheduler::TakeFix", ttff, &GpsFixScheduler::TakeFix, this);
+  }
+
+  void TakeFix() {
+    m_model->NotifyFix();
+    Vector truth = m_mobility->GetPosition();
+    m_lastFix = Vector(truth.x + m_noise->GetValue(), truth.y + m_noise->GetValue(), truth.z);
+    m_hasFix = true;
+    m_fixes++;
+    m_fixError.Add(HorizontalDistance(m_lastFix, truth));
+    m_fixTrace(m_lastFix, truth);
+
+    m_interval = NextInterval();
+    m_nextFix = Simulator::Now() + m_interval;
+    if (!m_model->ShouldStayOn(m_interval)) {
+      m_model->ChangeState(GpsReceiverEnergyModel::SLEEP);
+    }
+    ScheduleNextFix();
+  }
+
+  Time NextInterval() const {
+    if (!m_adaptive) {
+      return m_fixedInterval;
+    }
+    Vector v = m_mobility->GetVelocity();
+    double speed = std::sqrt(v.x * v.x + v.y * v.y);
+    if (speed < m_stoppedSpeed) {
+      return std::min(std::max(m_interval * 2, m_minInterval), m_maxInterval);
+    }
+    return std::min(std::max(Seconds(m_distancePerFix / speed), m_minInterval), m_maxInterval);
+  }
+
+  void Audit() {
+    if (m_hasFix) {
+      m_trackingError.Add(HorizontalDistance(m_lastFix, m_mobility->GetPosition()));
+    }
+    m_audit = ScheduleLabelled("GpsFixScheduler::Audit", m_auditInterval, &GpsFixScheduler::Audit, this);
+  }
+
+  static double HorizontalDistance(const Vector &a, const Vector &b) {
+    double dx = a.x - b.x;
+    double dy = a.y - b.y;
+    return std::sqrt(dx * dx + dy * dy);
+  }
+
+  Ptr<GpsReceiverEnergyModel> m_model;
+  Ptr<MobilityModel> m_mobility;
+  Ptr<NormalRandomVariable> m_noise;
+  EventId m_event;
+  EventId m_audit;
+  bool m_adaptive;
+  Time m_fixedInterval;
+  double m_distancePerFix;
+  Time m_minInterval;
+  Time m_maxInterval;
+  double m_stoppedSpeed;
+  double m_horizontalError;
+  Time m_auditInterval;
+
+  Time m_interval;
+  Time m_nextFix;
+  Vector m_lastFix;
+  bool m_hasFix;
+  uint32_t m_fixes;
+  DistanceStats m_fixError;
+  DistanceStats m_trackingError;
+  TracedCallback<const Vector &, const Vector &> m_fixTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(GpsFixScheduler);
+
+} // namespace ns3
+
+#endif /* GPS_ENERGY_MODEL_H */
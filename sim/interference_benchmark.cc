@@ -0,0 +1,246 @@
+#include "ns3/core-module.h"
+#include "interference_index.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("InterferenceBenchmark");
+
+// Scaling benchmark for the gateway interference tracker: replays the same
+// uplink load through the flat-list scan used by LoraInterferenceHelper and
+// through InterferenceIndex, checks that every collision decision matches,
+// and times both from minDevices to maxDevices per gateway.
+
+// ==================== LORA PARAMETERS ====================
+// Airtime of a 20 B uplink at BW 125 kHz, CR 4/5, SF7..SF12 (seconds)
+const double AIRTIME[6] = {0.0566, 0.1029, 0.1854, 0.3707, 0.7414, 1.3189};
+
+// LoraInterferenceHelper::collisionSnirGoursaud, signal SF x interferer SF (dB)
+const double ISOLATION_DB[6][6] = {
+  {6, -16, -18, -19, -19, -20},
+  {-24, 6, -20, -22, -22, -22},
+  {-27, -27, 6, -23, -25, -25},
+  {-30, -30, -30, 6, -26, -28},
+  {-33, -33, -33, -33, 6, -29},
+  {-36, -36, -36, -36, -36, 6},
+};
+
+const int64_t TICKS_PER_SECOND = 1000000000;  // ns, like ns-3's default resolution
+
+struct Uplink {
+  int64_t start;
+  int64_t end;
+  uint32_t channel;
+  uint8_t sf;      // 7..12
+  double powerW;
+};
+
+// Same decision LoraInterferenceHelper::IsDestroyedByInterference makes
+bool IsDestroyed(const Uplink &signal, const std::array<double, InterferenceIndex::MAX_SF> &energy) {
+  double signalEnergy = signal.powerW * (signal.end - signal.start);
+  for (int sf = 7; sf <= 12; ++sf) {
+    if (energy[sf] <= 0) {
+      continue;
+    }
+    double sirDb = 10 * std::log10(signalEnergy / energy[sf]);
+    if (sirDb < ISOLATION_DB[signal.sf - 7][sf - 7]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<Uplink> GenerateLoad(uint32_t devices, double periodS, double windowS,
+                                 uint32_t channels, std::mt19937_64 &rng) {
+  std::uniform_real_distribution<double> phase(0, periodS);
+  std::uniform_int_distribution<int> sf(7, 12);
+  std::uniform_int_distribution<uint32_t> channel(0, channels - 1);
+  std::uniform_real_distribution<double> rxPowerDbm(-135, -80);
+
+  std::vector<Uplink> load;
+  for (uint32_t d = 0; d < devices; ++d) {
+    for (double t = phase(rng); t < windowS; t += periodS) {
+      Uplink u;
+      u.sf = sf(rng);
+      u.start = static_cast<int64_t>(t * TICKS_PER_SECOND);
+      u.end = u.start + static_cast<int64_t>(AIRTIME[u.sf - 7] * TICKS_PER_SECOND);
+      u.channel = channel(rng);
+      u.powerW = std::pow(10.0, (rxPowerDbm(rng) - 30) / 10);
+      load.push_back(u);
+    }
+  }
+  std::sort(load.begin(), load.end(),
+            [](const Uplink &a, const Uplink &b) { return a.start < b.start; });
+  return load;
+}
+
+// Replays the load as reception start/end events. Each reception is judged
+// when it ends, against everything that overlapped it.
+template <typename Tracker>
+std::vector<bool> Replay(const std::vector<Uplink> &load, Tracker &tracker) {
+  std::vector<bool> destroyed(load.size());
+  std::multiset<std::pair<int64_t, size_t>> ends;  // in-flight receptions by end time
+  std::multiset<int64_t> inFlightStarts;
+
+  auto finish = [&]() {
+    auto first = ends.begin();
+    size_t i = first->second;
+    destroyed[i] = IsDestroyed(load[i], tracker.Energy(i));
+    inFlightStarts.erase(inFlightStarts.find(load[i].start));
+    ends.erase(first);
+  };
+
+  for (size_t i = 0; i < load.size(); ++i) {
+    while (!ends.empty() && ends.begin()->first <= load[i].start) {
+      finish();
+    }
+    // Nothing that ended before the oldest in-flight reception can matter
+    int64_t horizon = inFlightStarts.empty() ? load[i].start
+                                             : std::min(*inFlightStarts.begin(), load[i].start);
+    tracker.Expire(horizon);
+    tracker.Add(i, load[i]);
+    ends.insert(std::make_pair(load[i].end, i));
+    inFlightStarts.insert(load[i].start);
+  }
+  while (!ends.empty()) {
+    finish();
+  }
+  return destroyed;
+}
+
+// ==================== TRACKERS ====================
+// Flat list with the helper's behaviour: every query scans every stored
+// event, and events are only dropped `retention` after they end.
+class FlatTracker {
+public:
+  explicit FlatTracker(int64_t retention) : m_retention(retention) {}
+
+  void Add(size_t i, const Uplink &u) {
+    m_events.push_back(std::make_pair(i, u));
+  }
+
+  void Expire(int64_t horizon) {
+    std::vector<std::pair<size_t, Uplink>> kept;
+    kept.reserve(m_events.size());
+    for (const auto &e : m_events) {
+      if (e.second.end + m_retention > horizon) {
+        kept.push_back(e);
+      }
+    }
+    m_events.swap(kept);
+  }
+
+  std::array<double, InterferenceIndex::MAX_SF> Energy(size_t self) const {
+    std::array<double, InterferenceIndex::MAX_SF> energy;
+    energy.fill(0.0);
+    const Uplink *signal = nullptr;
+    for (const auto &e : m_events) {
+      if (e.first == self) {
+        signal = &e.second;
+      }
+    }
+    for (const auto &e : m_events) {
+      const Uplink &u = e.second;
+      if (e.first == self || u.channel != signal->channel) {
+        continue;
+      }
+      int64_t overlap = std::min(signal->end, u.end) - std::max(signal->start, u.start);
+      if (overlap > 0) {
+        energy[u.sf] += u.powerW * overlap;
+      }
+    }
+    return energy;
+  }
+
+private:
+  int64_t m_retention;
+  std::vector<std::pair<size_t, Uplink>> m_events;
+};
+
+class IndexedTracker {
+public:
+  void Add(size_t i, const Uplink &u) {
+    if (m_ids.size() <= i) {
+      m_ids.resize(i + 1);
+    }
+    m_ids[i] = m_index.Add(u.channel, u.sf, u.start, u.end, u.powerW);
+  }
+
+  void Expire(int64_t horizon) { m_index.Expire(horizon); }
+
+  std::array<double, InterferenceIndex::MAX_SF> Energy(size_t self) const {
+    return m_index.GetInterferenceEnergy(m_ids[self]);
+  }
+
+private:
+  InterferenceIndex m_index;
+  std::vector<uint64_t> m_ids;
+};
+
+int main(int argc, char *argv[]) {
+  uint32_t minDevices = 1000;
+  uint32_t maxDevices = 100000;
+  uint32_t channels = 3;
+  double period = 600;
+  double window = 3600;
+  double retention = 2;
+  uint32_t seed = 1;
+
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("minDevices", "Smallest fleet per gateway", minDevices);
+  cmd.AddValue("maxDevices", "Largest fleet per gateway", maxDevices);
+  cmd.AddValue("channels", "Uplink channels", channels);
+  cmd.AddValue("period", "Report period per device (s)", period);
+  cmd.AddValue("window", "Simulated time replayed per fleet size (s)", window);
+  cmd.AddValue("retention", "Time the flat list keeps finished events (s)", retention);
+  cmd.AddValue("seed", "Load generator seed", seed);
+  cmd.Parse(argc, argv);
+
+  std::cout << std::setw(10) << "devices" << std::setw(12) << "packets"
+            << std::setw(12) << "flat ms" << std::setw(12) << "index ms"
+            << std::setw(10) << "speedup" << std::setw(12) << "collisions"
+            << std::setw(12) << "mismatches" << std::endl;
+
+  int exitCode = 0;
+  for (uint32_t devices = minDevices; devices <= maxDevices; devices *= 10) {
+    std::mt19937_64 rng(seed);
+    std::vector<Uplink> load = GenerateLoad(devices, period, window, channels, rng);
+
+    FlatTracker flat(static_cast<int64_t>(retention * TICKS_PER_SECOND));
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<bool> flatResult = Replay(load, flat);
+    auto t1 = std::chrono::steady_clock::now();
+
+    IndexedTracker indexed;
+    std::vector<bool> indexResult = Replay(load, indexed);
+    auto t2 = std::chrono::steady_clock::now();
+
+    uint64_t collisions = 0;
+    uint64_t mismatches = 0;
+    for (size_t i = 0; i < load.size(); ++i) {
+      collisions += indexResult[i];
+      mismatches += flatResult[i] != indexResult[i];
+    }
+    double flatMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double indexMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+    std::cout << std::setw(10) << devices << std::setw(12) << load.size()
+              << std::setw(12) << std::fixed << std::setprecision(1) << flatMs
+              << std::setw(12) << indexMs
+              << std::setw(10) << std::setprecision(1) << flatMs / indexMs
+              << std::setw(12) << collisions
+              << std::setw(12) << mismatches << std::endl;
+    if (mismatches > 0) {
+      NS_LOG_UNCOND("Collision outcomes differ between the flat list and the index");
+      exitCode = 1;
+    }
+  }
+  return exitCode;
+}
@@ -0,0 +1,323 @@
+#ifndef INTERFERENCE_INDEX_H
+#define INTERFERENCE_INDEX_H
+
+#include "ns3/abort.h"
+#include "ns3/global-value.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== INTERFERENCE INDEX ====================
+// Gateway-side bookkeeping of in-flight receptions, indexed by channel,
+// spreading factor and start time. LoraInterferenceHelper (and the Sigfox
+// copy of it) keeps one flat list and scans all of it for every new packet,
+// which is quadratic in offered load. Here each (channel, SF) keeps its
+// receptions ordered by start, and since no reception lasts longer than the
+// longest one seen on it, everything that can overlap [start, end) starts in
+// [start - maxDuration, end).
+//
+// A query is one O(log n) lookup per SF in use on the channel plus a scan of
+// that window, so it is not logarithmic under load: it visits the k actual
+// overlaps plus receptions that started within maxDuration but had already
+// ended. Keeping SFs apart makes maxDuration one SF's airtime rather than
+// SF12's (~1.3 s), so the wasted part only comes from payload length spread.
+//
+// Finished receptions are expired incrementally from a min-heap on end time.
+// Within a (channel, SF), overlaps are visited in start order, which is
+// insertion order when receptions are added as they arrive, so the per-SF
+// sums over interferers come out bit-identical to the flat-list scan.
+//
+// IndexedInterference below is what the LoRa and Sigfox interference helpers
+// use once Dockerfile.LoRaWAN / Dockerfile.Sigfox have patched it in.
+//
+// Times are integer ticks (e.g. ns-3 Time::GetTimeStep()); the channel key is
+// whatever distinguishes non-interfering receptions (frequency, sub-band).
+class InterferenceIndex {
+public:
+  static const uint32_t MAX_SF = 16;
+
+  struct Reception {
+    uint64_t id;
+    int64_t start;
+    int64_t end;
+    uint32_t channel;
+    uint8_t sf;
+    double powerW;
+  };
+
+  InterferenceIndex() : m_nextId(0), m_size(0) {}
+
+  uint64_t Add(uint32_t channel, uint8_t sf, int64_t start, int64_t end, double powerW) {
+    Bucket &ch = m_channels[channel][sf % MAX_SF];
+    Reception rx = {m_nextId++, start, end, channel, sf, powerW};
+    auto it = ch.byStart.emplace_hint(ch.byStart.end(), start, rx);
+    ch.maxDuration = std::max(ch.maxDuration, end - start);
+    m_byId[rx.id] = it;
+    m_expiry.push(std::make_pair(end, rx.id));
+    m_size++;
+    return rx.id;
+  }
+
+  // Calls fn(reception, overlapTicks) for every other reception on the same
+  // channel that overlaps [start, end), one SF after the other.
+  template <typename Fn>
+  void ForEachOverlap(uint32_t channel, int64_t start, int64_t end, uint64_t self, Fn fn) const {
+    auto found = m_channels.find(channel);
+    if (found == m_channels.end()) {
+      return;
+    }
+    for (const Bucket &bucket : found->second) {
+      const auto &byStart = bucket.byStart;
+      if (byStart.empty()) {
+        continue;
+      }
+      for (auto it = byStart.lower_bound(start - bucket.maxDuration);
+           it != byStart.end() && it->first < end; ++it) {
+        const Reception &rx = it->second;
+        if (rx.id == self || rx.end <= start) {
+          continue;
+        }
+        fn(rx, std::min(end, rx.end) - std::max(start, rx.start));
+      }
+    }
+  }
+
+  // Interference energy (W x ticks) falling on a reception, per spreading
+  // factor, as LoraInterferenceHelper::IsDestroyedByInterference sums it.
+  std::array<double, MAX_SF> GetInterferenceEnergy(uint64_t id) const {
+    std::array<double, MAX_SF> energy;
+    energy.fill(0.0);
+    auto found = m_byId.find(id);
+    if (found == m_byId.end()) {
+      return energy;
+    }
+    const Reception &self = found->second->second;
+    ForEachOverlap(self.channel, self.start, self.end, self.id,
+                   [&energy](const Reception &rx, int64_t overlap) {
+                     energy[rx.sf % MAX_SF] += rx.powerW * overlap;
+                   });
+    return energy;
+  }
+
+  // Drops every reception that ended at or before `horizon`. Call with the
+  // start of the oldest reception that may still be queried: nothing that
+  // ended earlier can overlap it.
+  void Expire(int64_t horizon) {
+    Expire(horizon, [](const Reception &) {});
+  }
+
+  // Same, calling fn(reception) for each one dropped.
+  template <typename Fn>
+  void Expire(int64_t horizon, Fn fn) {
+    while (!m_expiry.empty() && m_expiry.top().first <= horizon) {
+      uint64_t id = m_expiry.top().second;
+      m_expiry.pop();
+      auto found = m_byId.find(id);
+      if (found == m_byId.end()) {
+        continue;  // already removed
+      }
+      fn(found->second->second);
+      Erase(found);
+    }
+  }
+
+  // Drops one reception before it expires.
+  void Remove(uint64_t id) {
+    auto found = m_byId.find(id);
+    if (found != m_byId.end()) {
+      Erase(found);
+    }
+  }
+
+  void Clear() {
+    m_channels.clear();
+    m_byId.clear();
+    m_expiry = std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>>();
+    m_size = 0;
+  }
+
+  std::size_t GetSize() const { return m_size; }
+
+private:
+  struct Bucket {
+    Bucket() : maxDuration(0) {}
+    std::multimap<int64_t, Reception> byStart;
+    int64_t maxDuration;
+  };
+  typedef std::multimap<int64_t, Reception>::iterator Handle;
+  typedef std::pair<int64_t, uint64_t> Expiry;
+
+  void Erase(std::unordered_map<uint64_t, Handle>::iterator found) {
+    const Reception &rx = found->second->second;
+    m_channels[rx.channel][rx.sf % MAX_SF].byStart.erase(found->second);
+    m_byId.erase(found);
+    m_size--;
+  }
+
+  std::unordered_map<uint32_t, std::array<Bucket, MAX_SF>> m_channels;
+  std::unordered_map<uint64_t, Handle> m_byId;
+  std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> m_expiry;
+  uint64_t m_nextId;
+  std::size_t m_size;
+};
+
+
+// ==================== MODULE HOOK ====================
+// The Dockerfiles patch one of these into LoraInterferenceHelper and
+// SigfoxInterferenceHelper. Add() and Erase() stand in for the helper's
+// m_events.push_back and m_events.erase, so the index holds exactly what
+// the helper's list holds, old events it has not cleaned yet included. Its
+// IsDestroyedByInterference() then loops over Candidates() instead of all
+// of m_events: the overlapping events on the same frequency, each SF's in
+// arrival order as m_events has them. The helper's own per-interferer
+// arithmetic is untouched, so its energy sums and collision decisions are
+// the same as with the flat scan. The list and CleanOldEvents stay as they
+// are; only the per-reception scan is narrowed.
+//
+// The InterferenceIndex global value (--InterferenceIndex=N, or the sims'
+// --interferenceIndex) picks the mode when the helper is built:
+//   0  the module's flat scan, untouched;
+//   1  candidates from the index;
+//   2  candidates from the index, each set checked against a flat scan of
+//      m_events; the first difference is fatal.
+//
+// The global value is defined by the module's .cc, which the Dockerfiles
+// make include this header with INTERFERENCE_INDEX_GLOBALS defined.
+#ifdef INTERFERENCE_INDEX_GLOBALS
+static GlobalValue g_interferenceIndex("InterferenceIndex",
+                                       "Gateway interference lookups: 0 = flat list, 1 = "
+                                       "InterferenceIndex, 2 = index checked against the flat list",
+                                       UintegerValue(0),
+                                       MakeUintegerChecker<uint32_t>(0, 2));
+#endif
+
+// Spreading factor of a module event; Sigfox events have none
+template <typename Event>
+auto InterferenceEventSf(const Event &event, int) -> decltype(uint8_t(event.GetSpreadingFactor())) {
+  return event.GetSpreadingFactor();
+}
+
+template <typename Event>
+uint8_t InterferenceEventSf(const Event &, long) {
+  return 0;
+}
+
+template <typename EventPtr>
+class IndexedInterference {
+public:
+  typedef typename std::list<EventPtr>::iterator Iterator;
+
+  IndexedInterference() : m_longest(0) {
+    UintegerValue mode;
+    GlobalValue::GetValueByName("InterferenceIndex", mode);
+    m_mode = mode.Get();
+  }
+
+  void Add(const EventPtr &event, std::list<EventPtr> &events) {
+    events.push_back(event);
+    if (m_mode == 0) {
+      return;
+    }
+    int64_t start = event->GetStartTime().GetTimeStep();
+    int64_t end = event->GetEndTime().GetTimeStep();
+    // Receptions still to be judged started at most m_longest ago, so
+    // anything that ended before that can no longer be a candidate
+    m_longest = std::max(m_longest, end - start);
+    m_index.Expire(start - m_longest, [this](const InterferenceIndex::Reception &rx) {
+      auto found = m_eventsById.find(rx.id);
+      m_ids.erase(PeekPointer(found->second));
+      m_eventsById.erase(found);
+    });
+    double powerW = std::pow(10.0, event->GetRxPowerdBm() / 10.0) / 1000.0;
+    uint64_t id = m_index.Add(GetChannel(event), InterferenceEventSf(*event, 0), start, end, powerW);
+    m_ids[PeekPointer(event)] = id;
+    m_eventsById[id] = event;
+  }
+
+  Iterator Erase(std::list<EventPtr> &events, Iterator it) {
+    auto found = m_ids.find(PeekPointer(*it));
+    if (found != m_ids.end()) {
+      m_index.Remove(found->second);
+      m_eventsById.erase(found->second);
+      m_ids.erase(found);
+    }
+    return events.erase(it);
+  }
+
+  // What IsDestroyedByInterference should loop over for `event`.
+  std::list<EventPtr> &Candidates(const EventPtr &event, std::list<EventPtr> &events) {
+    if (m_mode == 0) {
+      return events;
+    }
+    m_candidates.clear();
+    auto self = m_ids.find(PeekPointer(event));
+    if (self != m_ids.end()) {
+      m_index.ForEachOverlap(GetChannel(event), event->GetStartTime().GetTimeStep(),
+                             event->GetEndTime().GetTimeStep(), self->second,
+                             [this](const InterferenceIndex::Reception &rx, int64_t) {
+                               m_candidates.push_back(m_eventsById.find(rx.id)->second);
+                             });
+    }
+    if (m_mode == 2) {
+      Check(event, events);
+    }
+    return m_candidates;
+  }
+
+  void Clear() {
+    m_index.Clear();
+    m_ids.clear();
+    m_eventsById.clear();
+    m_candidates.clear();
+    m_longest = 0;
+  }
+
+private:
+  // Exact frequency match, as the helpers compare them
+  uint32_t GetChannel(const EventPtr &event) {
+    return m_channels.emplace(double(event->GetFrequency()), uint32_t(m_channels.size())).first->second;
+  }
+
+  void Check(const EventPtr &event, const std::list<EventPtr> &events) const {
+    std::vector<EventPtr> flat;
+    for (const EventPtr &other : events) {
+      if (other != event && other->GetFrequency() == event->GetFrequency() &&
+          other->GetStartTime() < event->GetEndTime() && other->GetEndTime() > event->GetStartTime()) {
+        flat.push_back(other);
+      }
+    }
+    std::stable_sort(flat.begin(), flat.end(), [](const EventPtr &a, const EventPtr &b) {
+      return InterferenceEventSf(*a, 0) % InterferenceIndex::MAX_SF <
+             InterferenceEventSf(*b, 0) % InterferenceIndex::MAX_SF;
+    });
+    NS_ABORT_MSG_IF(flat.size() != m_candidates.size() ||
+                    !std::equal(flat.begin(), flat.end(), m_candidates.begin()),
+                    "InterferenceIndex: " << m_candidates.size() << " candidates for the event at "
+                    << event->GetStartTime().GetSeconds() << " s, the flat list has " << flat.size());
+  }
+
+  uint32_t m_mode;
+  int64_t m_longest;
+  InterferenceIndex m_index;
+  std::unordered_map<const void *, uint64_t> m_ids;
+  std::unordered_map<uint64_t, EventPtr> m_eventsById;
+  std::map<double, uint32_t> m_channels;
+  std::list<EventPtr> m_candidates;
+};
+
+} // namespace ns3
+
+#endif /* INTERFERENCE_INDEX_H */
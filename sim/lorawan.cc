@@ -21,6 +21,7 @@
 #include "ns3/gateway-lorawan-mac.h"
 #include "ns3/log.h"
 #include "ns3/lora-helper.h"
+#include "ns3/lora-net-device.h"
 #include "ns3/lora-radio-energy-model-helper.h"
 #include "ns3/mobility-helper.h"
 #include "ns3/names.h"
@@ -28,15 +29,43 @@
 #include "ns3/periodic-sender-helper.h"
 #include "ns3/position-allocator.h"
 #include "ns3/simulator.h"
+#include "culled_lora_channel.h"
+#include "event_profiler.h"
+#include "results_store.h"
 
 #include <algorithm>
 #include <ctime>
+#include <iostream>
+#include <memory>
+#include <sstream>
 
 using namespace ns3;
 using namespace lorawan;
 
 NS_LOG_COMPONENT_DEFINE("LoraEnergyModelExample");
 
+std::unique_ptr<ResultsStore> results;
+uint32_t gatewayReceived = 0;
+uint32_t gatewayInterfered = 0;
+
+void
+RemainingEnergySample(double oldValue, double remainingEnergy)
+{
+    results->AddSample("battery_remaining", Simulator::Now().GetSeconds(), remainingEnergy);
+}
+
+void
+GatewayReceived(Ptr<const Packet> packet, uint32_t systemId)
+{
+    gatewayReceived++;
+}
+
+void
+GatewayInterfered(Ptr<const Packet> packet, uint32_t systemId)
+{
+    gatewayInterfered++;
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -65,6 +94,56 @@ main(int argc, char* argv[])
     LogComponentEnableAll(LOG_PREFIX_NODE);
     LogComponentEnableAll(LOG_PREFIX_TIME);
 
+    std::string resultsDb = "logs/results.db";
+    bool profile = false;
+    uint32_t profileTop = 20;
+    bool rangeCulling = false;
+    uint32_t interferenceIndex = 0;
+    uint32_t nDevices = 1;
+    uint32_t nGateways = 1;
+    Time appPeriod = Seconds(5);
+    Time simTime = Hours(24);
+    uint32_t seed = 1;
+    uint32_t run = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("nDevices", "Number of end devices", nDevices);
+    cmd.AddValue("nGateways", "Number of gateways", nGateways);
+    cmd.AddValue("period", "Time between uplinks of each end device", appPeriod);
+    cmd.AddValue("simTime", "Simulated time", simTime);
+    cmd.AddValue("seed", "RngSeedManager seed", seed);
+    cmd.AddValue("run", "RngSeedManager run number", run);
+    cmd.AddValue("resultsDb", "SQLite results database, relative to the ns-3 root (empty to disable)", resultsDb);
+    cmd.AddValue("profile", "Print a wall-time profile of the event loop", profile);
+    cmd.AddValue("profileTop", "Event types and nodes listed in the profile", profileTop);
+    cmd.AddValue("rangeCulling", "Skip receivers beyond useful range on the channel", rangeCulling);
+    cmd.AddValue("interferenceIndex",
+                 "Gateway interference lookups: 0 = flat list, 1 = InterferenceIndex, "
+                 "2 = index checked against the flat list",
+                 interferenceIndex);
+    cmd.Parse(argc, argv);
+    RngSeedManager::SetSeed(seed);
+    RngSeedManager::SetRun(run);
+    GlobalValue::Bind("InterferenceIndex", UintegerValue(interferenceIndex));
+
+    if (profile)
+    {
+        EnableEventProfiler();
+    }
+
+    if (!resultsDb.empty())
+    {
+        std::ostringstream params;
+        params << "period=" << appPeriod.GetSeconds() << ";devices=" << nDevices
+               << ";gateways=" << nGateways << ";simTime=" << simTime.GetSeconds()
+               << ";rangeCulling=" << rangeCulling << ";interferenceIndex=" << interferenceIndex;
+        results = std::make_unique<ResultsStore>(resultsDb,
+                                                 "lorawan",
+                                                 params.str(),
+                                                 RngSeedManager::GetSeed(),
+                                                 RngSeedManager::GetRun());
+    }
+
     /************************
      *  Create the channel  *
      ************************/
@@ -78,7 +157,16 @@ main(int argc, char* argv[])
 
     Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel>();
 
-    Ptr<LoraChannel> channel = CreateObject<LoraChannel>(loss, delay);
+    Ptr<LoraChannel> channel;
+    Ptr<RangeCulledLoraChannel> culledChannel;
+    if (rangeCulling)
+    {
+        channel = culledChannel = CreateObject<RangeCulledLoraChannel>(loss, delay);
+    }
+    else
+    {
+        channel = CreateObject<LoraChannel>(loss, delay);
+    }
 
     /************************
      *  Create the helpers  *
@@ -111,7 +199,7 @@ main(int argc, char* argv[])
 
     // Create a set of nodes
     NodeContainer endDevices;
-    endDevices.Create(1);
+    endDevices.Create(nDevices);
 
     // Assign a mobility model to the node
     mobility.Install(endDevices);
@@ -127,7 +215,7 @@ main(int argc, char* argv[])
 
     NS_LOG_INFO("Creating the gateway...");
     NodeContainer gateways;
-    gateways.Create(1);
+    gateways.Create(nGateways);
 
     mobility.SetPositionAllocator(allocator);
     mobility.Install(gateways);
@@ -135,7 +223,16 @@ main(int argc, char* argv[])
     // Create a netdevice for each gateway
     phyHelper.SetDeviceType(LoraPhyHelper::GW);
     macHelper.SetDeviceType(LorawanMacHelper::GW);
-    helper.Install(phyHelper, macHelper, gateways);
+    NetDeviceContainer gatewayNetDevices = helper.Install(phyHelper, macHelper, gateways);
+
+    // Gateway outcomes, to compare runs with and without the interference index
+    for (uint32_t g = 0; g < gatewayNetDevices.GetN(); ++g)
+    {
+        Ptr<LoraPhy> phy = DynamicCast<LoraNetDevice>(gatewayNetDevices.Get(g))->GetPhy();
+        phy->TraceConnectWithoutContext("ReceivedPacket", MakeCallback(&GatewayReceived));
+        phy->TraceConnectWithoutContext("LostPacketBecauseInterference",
+                                        MakeCallback(&GatewayInterfered));
+    }
 
     LorawanMacHelper::SetSpreadingFactorsUp(endDevices, gateways, channel);
 
@@ -149,7 +246,7 @@ main(int argc, char* argv[])
     // oneShotSenderHelper.Install (endDevices);
 
     PeriodicSenderHelper periodicSenderHelper;
-    periodicSenderHelper.SetPeriod(Seconds(5));
+    periodicSenderHelper.SetPeriod(appPeriod);
 
     periodicSenderHelper.Install(endDevices);
 
@@ -188,14 +285,46 @@ main(int argc, char* argv[])
     fileHelper.ConfigureFile("battery-level", FileAggregator::SPACE_SEPARATED);
     fileHelper.WriteProbe("ns3::DoubleProbe", "/Names/EnergySource/RemainingEnergy", "Output");
 
+    if (results)
+    {
+        sources.Get(0)->TraceConnectWithoutContext("RemainingEnergy",
+                                                   MakeCallback(&RemainingEnergySample));
+    }
+
     /****************
      *  Simulation  *
      ****************/
 
-    Simulator::Stop(Hours(24));
+    Simulator::Stop(simTime);
 
     Simulator::Run();
 
+    PrintEventProfile(std::cout, profileTop);
+
+    if (culledChannel && culledChannel->GetGrid().GetQueries() > 0)
+    {
+        const ReceiverGrid<LoraPhy>& grid = culledChannel->GetGrid();
+        std::cout << "Range culling: " << grid.GetMeanCandidates() << " of " << grid.GetSize()
+                  << " PHYs evaluated per transmission over " << grid.GetQueries()
+                  << " transmissions" << std::endl;
+        if (results)
+        {
+            results->AddKpi("culled_candidates_per_tx", grid.GetMeanCandidates());
+        }
+    }
+
+    std::cout << "Gateway PHY: " << gatewayReceived << " received, " << gatewayInterfered
+              << " lost to interference" << std::endl;
+
+    if (results)
+    {
+        results->AddKpi("gateway_received", gatewayReceived);
+        results->AddKpi("gateway_lost_interference", gatewayInterfered);
+        results->AddKpi("remaining_energy_j", sources.Get(0)->GetRemainingEnergy());
+        results->AddKpi("radio_energy_j", deviceModels.Get(0)->GetTotalEnergyConsumption());
+        results.reset();
+    }
+
     Simulator::Destroy();
 
     return 0;
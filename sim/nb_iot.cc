@@ -9,30 +9,39 @@
 #include "ns3/applications-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/point-to-point-module.h"
+#include "nb_iot_energy_model.h"
+#include "gps_energy_model.h"
+#include "nb_iot_random_access.h"
+#include "tracker_payload.h"
+#include "results_store.h"
+#include "cell_deployment.h"
+#include "event_profiler.h"
+#include "track_store.h"
+#include "scenario_builder.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <memory>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("NBIoT");
 
+std::unique_ptr<ResultsStore> results;
+uint32_t fixesReceived = 0;
+TrackStore trackStore;  // Fixes as the server received them
+ReconstructionTracker reconstruction;  // Server's dead-reckoned view of each UE
+uint32_t handovers = 0;
+bool profile = false;
+uint32_t profileTop = 20;
+
 // ==================== LOGGING CALLBACKS ====================
 void EnergyConsumptionCallback(double oldEnergy, double newEnergy) {
   NS_LOG_DEBUG(Simulator::Now().GetSeconds() << "s: [ENERGY] Remaining: " 
                 << newEnergy << " J (Δ " << newEnergy - oldEnergy << " J)");
 }
 
-void PhyTxTrace(std::string context, Ptr<const Packet> p) {
-  std::size_t nodePos = context.find("/NodeList/");
-  uint32_t nodeId = std::stoi(context.substr(nodePos + 10, 1));
-
-  NS_LOG_DEBUG(Simulator::Now() << " Node " << nodeId 
-                << " TX: " << p->GetSize() << " bytes");
-}
-
-void PhyRxTrace(std::string context, Ptr<const Packet> p) {
-  NS_LOG_DEBUG(Simulator::Now().GetSeconds() << "s: [RX] " << context 
-                << " received packet " << p->GetUid() << " (" << p->GetSize() << " bytes)");
-}
-
 void DlRxErrorTrace(std::string context, Ptr<const Packet> p, double sinr) {
   NS_LOG_DEBUG(Simulator::Now().GetSeconds() << "s: [ERROR] DL packet " 
                 << p->GetUid() << " lost (SINR: " << sinr << " dB)");
@@ -43,38 +52,515 @@ void UlRxErrorTrace(std::string context, Ptr<const Packet> p, double sinr) {
                 << p->GetUid() << " lost (SINR: " << sinr << " dB)");
 }
 
-int main (int argc, char *argv[]) {
-  // Enable detailed logging
-  LogComponentEnable("LteUePhy", LOG_LEVEL_INFO);
-  LogComponentEnable("LteUeMac", LOG_LEVEL_DEBUG);
-  LogComponentEnable("LteEnbPhy", LOG_LEVEL_INFO);
-  LogComponentEnable("LteEnbMac", LOG_LEVEL_DEBUG);
-  LogComponentEnable("LteSpectrumPhy", LOG_LEVEL_DEBUG);
-  LogComponentEnable("NBIoT", LOG_LEVEL_ALL);
+void FixRxTrace(Ptr<const Packet> p, const Address &from) {
+  TrackerFixHeader fix;
+  p->PeekHeader(fix);
+  Time age = Simulator::Now() - fix.GetTimestamp();
+  NS_LOG_DEBUG(Simulator::Now().GetSeconds() << "s: [FIX] " << fix
+                << " (age " << age.As(Time::MS) << ")");
+  fixesReceived++;
+  Vector pos = fix.GetPosition();
+  trackStore.Append(fix.GetDeviceId(), fix.GetTimestamp().GetMilliSeconds(), pos.x, pos.y);
+  reconstruction.OnReport(fix.GetDeviceId(), fix.GetTimestamp(), pos, fix.GetVelocity());
+  if (results) {
+    results->AddSample("fix_age_ms", Simulator::Now().GetSeconds(), age.GetMilliSeconds(), fix.GetDeviceId());
+  }
+}
+
+// Compares the server's reconstruction of every UE with its true position.
+void SampleReconstruction(NodeContainer ueNodes, Time interval) {
+  for (NodeContainer::Iterator it = ueNodes.Begin(); it != ueNodes.End(); ++it) {
+    reconstruction.Sample((*it)->GetId(), (*it)->GetObject<MobilityModel>()->GetPosition());
+  }
+  ScheduleLabelled("SampleReconstruction", interval, &SampleReconstruction, ueNodes, interval);
+}
+
+void HandoverEndOkTrace(uint64_t imsi, uint16_t cellId, uint16_t rnti) {
+  NS_LOG_DEBUG(Simulator::Now().GetSeconds() << "s: [HANDOVER] IMSI " << imsi
+                << " now on cell " << cellId << " (RNTI " << rnti << ")");
+  handovers++;
+}
+
+void RemainingEnergySample(uint32_t nodeId, double oldEnergy, double newEnergy) {
+  results->AddSample("remaining_energy_j", Simulator::Now().GetSeconds(), newEnergy, nodeId);
+}
+
+// ==================== POWER SAVING SCENARIO ====================
+// Runs UEs through PSM/eDRX reporting cycles without the LTE stack, whose
+// 1 ms subframe events would make multi-day runs impractical, and projects
+// battery lifetime from the energy drawn over the run.
+int RunPowerSavingScenario(uint32_t numUeNodes, Time simTime, Time reportPeriod,
+                           double batteryMah, double supplyVoltage) {
+  double batteryJ = batteryMah * 3.6 * supplyVoltage;
+
+  NS_LOG_INFO("========== Power Saving Configuration ==========");
+  NS_LOG_INFO("UE Nodes: " << numUeNodes);
+  NS_LOG_INFO("Report Period: " << reportPeriod.As(Time::S));
+  NS_LOG_INFO("Battery: " << batteryMah << " mAh @ " << supplyVoltage << " V (" << batteryJ << " J)");
+  NS_LOG_INFO("Simulation Time: " << simTime.As(Time::S));
+  NS_LOG_INFO("================================================");
+
+  NodeContainer ueNodes;
+  ueNodes.Create(numUeNodes);
+
+  // Energy is only settled on state changes, so the periodic update would be
+  // the only thing waking the simulator between reports.
+  EnergySourceContainer energySources = InstallBasicEnergySources(ueNodes, batteryJ, supplyVoltage, simTime);
+
+  std::vector<Ptr<NbIotRadioEnergyModel>> models;
+  std::vector<Ptr<NbIotPowerSavingController>> controllers;
+  Ptr<UniformRandomVariable> offset = CreateObject<UniformRandomVariable>();
+  AttributeHandle controllerPeriod(NbIotPowerSavingController::GetTypeId(), "ReportPeriod",
+                                   TimeValue(reportPeriod));
+  for (uint32_t i = 0; i < ueNodes.GetN(); ++i) {
+    Ptr<EnergySource> source = energySources.Get(i);
+    Ptr<NbIotRadioEnergyModel> model = CreateObject<NbIotRadioEnergyModel>();
+    model->SetEnergySource(source);
+    source->AppendDeviceEnergyModel(model);
+
+    Ptr<NbIotPowerSavingController> controller = CreateObject<NbIotPowerSavingController>();
+    controllerPeriod.Apply(controller);
+    controller->SetRadioEnergyModel(model);
+    // Spread first reports over one period so UEs do not wake in lockstep
+    controller->Start(Seconds(offset->GetValue(0, reportPeriod.GetSeconds())));
+
+    models.push_back(model);
+    controllers.push_back(controller);
+  }
 
+  Simulator::Stop(simTime);
+  NS_LOG_INFO("Starting simulation...");
+  Simulator::Run();
+  PrintEventProfile(std::cout, profileTop);
+
+  // ==================== RESULTS ====================
+  std::vector<Time> residency(NbIotRadioEnergyModel::NUM_STATES, Seconds(0));
+  double totalEnergy = 0;
+  uint32_t totalReports = 0;
+  Time minLifetime = Time::Max();
+  for (uint32_t i = 0; i < models.size(); ++i) {
+    for (int s = 0; s < NbIotRadioEnergyModel::NUM_STATES; ++s) {
+      residency[s] += models[i]->GetResidency(static_cast<NbIotRadioEnergyModel::State>(s));
+    }
+    models[i]->ChangeState(models[i]->GetState());  // settle energy up to now
+    totalEnergy += models[i]->GetTotalEnergyConsumption();
+    totalReports += controllers[i]->GetReportsSent();
+    minLifetime = std::min(minLifetime, controllers[i]->ProjectLifetime(batteryJ));
+  }
+
+  double avgEnergy = totalEnergy / models.size();
+  double avgCurrentMa = avgEnergy / supplyVoltage / simTime.GetSeconds() * 1000;
+  double lifetimeDays = batteryMah / avgCurrentMa / 24.0;
+
+  std::cout << "\n=== Power Saving Results ===\n"
+            << "Reports sent: " << totalReports << "\n"
+            << "Average energy per UE: " << avgEnergy << " J\n"
+            << "Average current per UE: " << avgCurrentMa << " mA\n"
+            << "Projected battery lifetime: " << lifetimeDays << " days (worst UE "
+            << minLifetime.GetDays() << " days)\n"
+            << "State residency:\n";
+  for (int s = 0; s < NbIotRadioEnergyModel::NUM_STATES; ++s) {
+    std::cout << "  " << NbIotRadioEnergyModel::GetStateName(s) << ": "
+              << 100.0 * residency[s].GetSeconds() / (simTime.GetSeconds() * models.size())
+              << "%\n";
+  }
+
+  if (results) {
+    results->AddKpi("reports_sent", totalReports);
+    results->AddKpi("avg_energy_j", avgEnergy);
+    results->AddKpi("avg_current_ma", avgCurrentMa);
+    results->AddKpi("lifetime_days", lifetimeDays);
+    results->AddKpi("worst_lifetime_days", minLifetime.GetDays());
+    for (int s = 0; s < NbIotRadioEnergyModel::NUM_STATES; ++s) {
+      results->AddKpi("residency_s_" + NbIotRadioEnergyModel::GetStateName(s),
+                      residency[s].GetSeconds() / models.size());
+    }
+    results.reset();
+  }
+
+  Simulator::Destroy();
+  return 0;
+}
+
+// ==================== GPS SCENARIO ====================
+// Runs a GPS receiver on every vehicle of the mobility trace under three
+// schedules, each with its own battery so all see exactly the same
+// trajectory: speed-adaptive, fixed every FixedInterval, and fixed at the
+// adaptive schedule's mean interval. FixedInterval defaults to MinInterval,
+// so adaptive can only beat it on energy; the matched baseline spends the
+// same number of fixes evenly and shows what adapting actually buys, in
+// energy and in tracking error. The matched interval is only known once the
+// adaptive schedule has run, so it gets a second pass over the trace.
+// Scheduler and receiver parameters can be overridden with
+// --ns3::GpsFixScheduler::<Attribute> and --ns3::GpsReceiverEnergyModel::<Attribute>.
+int RunGpsScenario(uint32_t numUeNodes, Time simTime, const std::string &mobilityTrace,
+                   double batteryMah, double supplyVoltage) {
+  double batteryJ = batteryMah * 3.6 * supplyVoltage;
+
+  enum { ADAPTIVE = 0, FIXED, MATCHED, NUM_SCHEDULES };
+  static const char *scheduleNames[NUM_SCHEDULES] = {"adaptive", "fixed", "matched"};
+  double energy[NUM_SCHEDULES] = {0, 0, 0};
+  uint32_t fixes[NUM_SCHEDULES] = {0, 0, 0};
+  DistanceStats error[NUM_SCHEDULES];
+  std::vector<Time> residency[NUM_SCHEDULES];
+  DistanceStats fixError;
+  std::vector<uint32_t> starts(GpsReceiverEnergyModel::NUM_START_TYPES, 0);
+  uint32_t vehicles = 0;
+  Time matchedInterval;
+
+  // Runs schedules [first, last) over the whole trace and accumulates their
+  // results; everything is torn down again before returning.
+  auto runPass = [&](int first, int last) {
+    NodeContainer ueNodes;
+    ueNodes.Create(numUeNodes);
+    Ns2MobilityHelper ns2(mobilityTrace);
+    ns2.Install(ueNodes.Begin(), ueNodes.End());
+
+    std::vector<Ptr<GpsReceiverEnergyModel>> models[NUM_SCHEDULES];
+    std::vector<Ptr<GpsFixScheduler>> schedulers[NUM_SCHEDULES];
+    TypeId sourceTid = BasicEnergySource::GetTypeId();
+    AttributeHandle initialEnergy(sourceTid, "BasicEnergySourceInitialEnergyJ", DoubleValue(batteryJ));
+    AttributeHandle supplyVoltageV(sourceTid, "BasicEnergySupplyVoltageV", DoubleValue(supplyVoltage));
+    AttributeHandle updateInterval(sourceTid, "PeriodicEnergyUpdateInterval", TimeValue(simTime));
+    TypeId schedulerTid = GpsFixScheduler::GetTypeId();
+    AttributeHandle adaptive(schedulerTid, "Adaptive", BooleanValue(true));
+    AttributeHandle notAdaptive(schedulerTid, "Adaptive", BooleanValue(false));
+    AttributeHandle matched(schedulerTid, "FixedInterval", TimeValue(matchedInterval));
+    for (uint32_t i = 0; i < ueNodes.GetN(); ++i) {
+      Ptr<MobilityModel> mobility = ueNodes.Get(i)->GetObject<MobilityModel>();
+      if (mobility == nullptr) {
+        continue;  // not in the trace, nothing to measure against
+      }
+      for (int k = first; k < last; ++k) {
+        Ptr<BasicEnergySource> source = CreateObject<BasicEnergySource>();
+        initialEnergy.Apply(source);
+        supplyVoltageV.Apply(source);
+        updateInterval.Apply(source);
+        source->SetNode(ueNodes.Get(i));
+
+        Ptr<GpsReceiverEnergyModel> model = CreateObject<GpsReceiverEnergyModel>();
+        model->SetEnergySource(source);
+        source->AppendDeviceEnergyModel(model);
+
+        Ptr<GpsFixScheduler> scheduler = CreateObject<GpsFixScheduler>();
+        (k == ADAPTIVE ? adaptive : notAdaptive).Apply(scheduler);
+        if (k == MATCHED) {
+          matched.Apply(scheduler);
+        }
+        scheduler->SetReceiver(model);
+        scheduler->SetMobilityModel(mobility);
+        scheduler->Start(Seconds(0));
+
+        models[k].push_back(model);
+        schedulers[k].push_back(scheduler);
+      }
+    }
+    if (models[first].empty()) {
+      NS_FATAL_ERROR("No UE in 0.." << numUeNodes - 1 << " is driven by " << mobilityTrace);
+    }
+    vehicles = models[first].size();
+
+    NS_LOG_INFO("========== GPS Configuration ==========");
+    NS_LOG_INFO("Vehicles: " << vehicles << " (from " << mobilityTrace << ")");
+    NS_LOG_INFO("Schedules: " << scheduleNames[first] << " to " << scheduleNames[last - 1]);
+    NS_LOG_INFO("Simulation Time: " << simTime.As(Time::S));
+    NS_LOG_INFO("=======================================");
+
+    if (profile && first > 0) {
+      EnableEventProfiler();  // the first pass's Destroy took the profiler with it
+    }
+    Simulator::Stop(simTime);
+    NS_LOG_INFO("Starting simulation...");
+    Simulator::Run();
+    PrintEventProfile(std::cout, profileTop);
+
+    for (int k = first; k < last; ++k) {
+      residency[k].assign(GpsReceiverEnergyModel::NUM_STATES, Seconds(0));
+      for (uint32_t i = 0; i < vehicles; ++i) {
+        Ptr<GpsReceiverEnergyModel> model = models[k][i];
+        for (int s = 0; s < GpsReceiverEnergyModel::NUM_STATES; ++s) {
+          residency[k][s] += model->GetResidency(static_cast<GpsReceiverEnergyModel::State>(s));
+        }
+        model->ChangeState(model->GetState());  // settle energy up to now
+        energy[k] += model->GetTotalEnergyConsumption();
+        fixes[k] += schedulers[k][i]->GetFixes();
+        error[k].Merge(schedulers[k][i]->GetTrackingError());
+        if (k == ADAPTIVE) {
+          fixError.Merge(schedulers[k][i]->GetFixError());
+          for (int t = 0; t < GpsReceiverEnergyModel::NUM_START_TYPES; ++t) {
+            starts[t] += model->GetStarts(static_cast<GpsReceiverEnergyModel::StartType>(t));
+          }
+        }
+      }
+    }
+    Simulator::Destroy();
+  };
+
+  runPass(ADAPTIVE, MATCHED);
+  matchedInterval = fixes[ADAPTIVE] > 0
+    ? Seconds(simTime.GetSeconds() * vehicles / fixes[ADAPTIVE]) : simTime;
+  runPass(MATCHED, NUM_SCHEDULES);
+
+  // ==================== RESULTS ====================
+  std::cout << "\n=== GPS Results ===\n"
+            << "Vehicles: " << vehicles << "\n"
+            << "Matched interval: " << matchedInterval.GetSeconds() << " s\n";
+  for (int k = 0; k < NUM_SCHEDULES; ++k) {
+    std::cout << scheduleNames[k] << ": " << fixes[k] << " fixes, "
+              << energy[k] / vehicles << " J per vehicle, error to truth mean "
+              << error[k].GetMean() << " m, p95 " << error[k].GetPercentile(0.95) << " m, max "
+              << error[k].GetMax() << " m\n";
+    for (int s = 0; s < GpsReceiverEnergyModel::NUM_STATES; ++s) {
+      std::cout << "  " << GpsReceiverEnergyModel::GetStateName(s) << ": "
+                << 100.0 * residency[k][s].GetSeconds() / (simTime.GetSeconds() * vehicles) << "%\n";
+    }
+  }
+  double saved = energy[FIXED] > 0 ? 100.0 * (1.0 - energy[ADAPTIVE] / energy[FIXED]) : 0.0;
+  double savedMatched = energy[MATCHED] > 0 ? 100.0 * (1.0 - energy[ADAPTIVE] / energy[MATCHED]) : 0.0;
+  std::cout << "Adaptive starts: " << starts[GpsReceiverEnergyModel::HOT] << " hot, "
+            << starts[GpsReceiverEnergyModel::WARM] << " warm, "
+            << starts[GpsReceiverEnergyModel::COLD] << " cold\n"
+            << "Fix error: mean " << fixError.GetMean() << " m\n"
+            << "Energy saved vs fixed period: " << saved << "%\n"
+            << "Energy saved vs matched period: " << savedMatched << "%\n";
+
+  if (results) {
+    for (int k = 0; k < NUM_SCHEDULES; ++k) {
+      std::string suffix = std::string("_") + scheduleNames[k];
+      results->AddKpi("gps_fixes" + suffix, fixes[k]);
+      results->AddKpi("gps_energy_j" + suffix, energy[k] / vehicles);
+      results->AddKpi("gps_error_mean_m" + suffix, error[k].GetMean());
+      results->AddKpi("gps_error_p95_m" + suffix, error[k].GetPercentile(0.95));
+      results->AddKpi("gps_error_max_m" + suffix, error[k].GetMax());
+    }
+    for (int t = 0; t < GpsReceiverEnergyModel::NUM_START_TYPES; ++t) {
+      results->AddKpi("gps_starts_" + GpsReceiverEnergyModel::GetStartTypeName(t), starts[t]);
+    }
+    results->AddKpi("gps_matched_interval_s", matchedInterval.GetSeconds());
+    results->AddKpi("gps_energy_saved_pct", saved);
+    results->AddKpi("gps_energy_saved_pct_matched", savedMatched);
+    results.reset();
+  }
+
+  return 0;
+}
+
+// ==================== MASSIVE ACCESS SCENARIO ====================
+// Wakes every UE at once, as after a coverage or core outage, and follows
+// them through NPRACH contention until each one gets through or gives up,
+// for every fleet size in ueCounts under every carrier policy. LENA has no
+// NPRACH or non-anchor carriers, so this runs on NbIotRandomAccess alone;
+// NPRACH parameters can be overridden with --ns3::NbIotRandomAccess::<Attribute>.
+int RunMassiveAccessScenario(const std::string &ueCounts, Time wakeSpread) {
+  std::vector<uint32_t> counts;
+  std::istringstream list(ueCounts);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    // Digits only and at most 9 of them, so the count fits and stoul cannot throw
+    if (item.empty() || item.size() > 9 || item.find_first_not_of("0123456789") != std::string::npos ||
+        std::stoul(item) == 0) {
+      NS_FATAL_ERROR("--accessUes takes a comma-separated list of positive UE counts, got \"" << item << "\"");
+    }
+    counts.push_back(std::stoul(item));
+  }
+  if (counts.empty()) {
+    NS_FATAL_ERROR("--accessUes lists no UE counts");
+  }
+
+  std::cout << "\n=== Massive Access Results ===\n"
+            << std::setw(12) << "policy" << std::setw(8) << "UEs" << std::setw(9) << "success"
+            << std::setw(11) << "collision" << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms"
+            << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << std::setw(10) << "attempts"
+            << "  carrier utilisation\n";
+  for (int policy = NbIotRandomAccess::ANCHOR_ONLY; policy <= NbIotRandomAccess::LEAST_LOADED; ++policy) {
+    for (uint32_t ues : counts) {
+      if (profile && ProfilingScheduler::Get() == nullptr) {
+        EnableEventProfiler();  // the previous run's Destroy took the profiler with it
+      }
+      Ptr<NbIotRandomAccess> access = CreateObject<NbIotRandomAccess>();
+      access->SetAttribute("CarrierPolicy", EnumValue(policy));
+      access->Start(ues, Seconds(0), wakeSpread);
+      Simulator::Run();
+
+      std::vector<Time> delays = access->GetAccessDelays();
+      std::sort(delays.begin(), delays.end());
+      auto percentile = [&delays](double p) {
+        if (delays.empty()) {
+          return 0.0;
+        }
+        std::size_t rank = std::max<std::size_t>(std::ceil(p * delays.size()), 1);
+        return delays[std::min(rank, delays.size()) - 1].GetSeconds() * 1000;
+      };
+      double success = static_cast<double>(delays.size()) / ues;
+      double collision = access->GetPreambles() > 0
+        ? static_cast<double>(access->GetCollidedPreambles()) / access->GetPreambles() : 0.0;
+      double attempts = static_cast<double>(access->GetPreambles()) / ues;
+
+      std::cout << std::setw(12) << NbIotRandomAccess::GetPolicyName(policy) << std::setw(8) << ues
+                << std::setw(9) << std::fixed << std::setprecision(3) << success
+                << std::setw(11) << collision << std::setprecision(0)
+                << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.9)
+                << std::setw(10) << percentile(0.99) << std::setw(10) << percentile(1.0)
+                << std::setw(10) << std::setprecision(2) << attempts << " ";
+      for (uint32_t c = 0; c < access->GetCarriers(); ++c) {
+        std::cout << " " << std::setprecision(3) << access->GetUtilisation(c);
+      }
+      std::cout << std::defaultfloat << "\n";
+
+      if (results) {
+        std::string suffix = "_" + NbIotRandomAccess::GetPolicyName(policy) + "_" + std::to_string(ues);
+        results->AddKpi("access_success" + suffix, success);
+        results->AddKpi("access_collision_rate" + suffix, collision);
+        results->AddKpi("access_p50_ms" + suffix, percentile(0.5));
+        results->AddKpi("access_p90_ms" + suffix, percentile(0.9));
+        results->AddKpi("access_p99_ms" + suffix, percentile(0.99));
+        results->AddKpi("access_max_ms" + suffix, percentile(1.0));
+        results->AddKpi("access_attempts" + suffix, attempts);
+        for (uint32_t c = 0; c < access->GetCarriers(); ++c) {
+          results->AddKpi("access_utilisation_c" + std::to_string(c) + suffix, access->GetUtilisation(c));
+        }
+      }
+      if (profile) {
+        std::cout << "\nProfile for " << NbIotRandomAccess::GetPolicyName(policy) << ", " << ues << " UEs:";
+        PrintEventProfile(std::cout, profileTop);
+      }
+      Simulator::Destroy();
+    }
+  }
+
+  if (results) {
+    results.reset();
+  }
+  return 0;
+}
+
+int main (int argc, char *argv[]) {
   // ==================== CLI CONFIGURATION ====================
   Time simTime = Seconds(30);
   uint32_t numUeNodes = 1;
-  uint32_t numEnbNodes = 1;
+  uint32_t numEnbNodes = 0;
   double packetLossRate = 0.0;
   bool useCa = false;
+  bool psm = false;
+  bool gps = false;
+  bool massiveAccess = false;
+  std::string accessUes = "100,1000,5000,10000,50000";
+  Time wakeSpread = Seconds(0);
+  Time reportPeriod = Minutes(15);
+  double batteryMah = 5000;
+  double supplyVoltage = 3.6;
+  std::string resultsDb = "logs/results.db";
+  std::string enbSites = "scratch/enb_sites.txt";
+  std::string mobilityTrace = "scratch/ns3.tcl";
+  bool handover = true;
+  bool verbose = false;
+  double errorBound = 0;
+  Time maxSilence = Seconds(300);
+  uint32_t seed = 1;
+  uint32_t run = 1;
 
   CommandLine cmd(__FILE__);
+  cmd.AddValue("seed", "RngSeedManager seed", seed);
+  cmd.AddValue("run", "RngSeedManager run number", run);
   cmd.AddValue("simTime", "Simulation duration", simTime);
   cmd.AddValue("numNodes", "Number of UE nodes", numUeNodes);
-  cmd.AddValue("numRadioTowers", "Number of eNBs", numEnbNodes);
+  cmd.AddValue("numRadioTowers", "Number of eNB sites to use from enbSites (0 = all)", numEnbNodes);
+  cmd.AddValue("enbSites", "eNB site file (x y [z [name]] in the SUMO projection)", enbSites);
+  cmd.AddValue("mobilityTrace", "ns-2 mobility trace for the UEs (empty for static UEs)", mobilityTrace);
+  cmd.AddValue("handover", "Enable X2 handover between cells", handover);
+  cmd.AddValue("verbose", "Enable LTE PHY/MAC and scenario logging", verbose);
+  cmd.AddValue("profile", "Print a wall-time profile of the event loop", profile);
+  cmd.AddValue("profileTop", "Event types and nodes listed in the profile", profileTop);
   cmd.AddValue("packetLossRate", "Target packet loss rate", packetLossRate);
   cmd.AddValue("useCa", "Enable carrier aggregation", useCa);
+  cmd.AddValue("errorBound", "Only report when dead reckoning is off by more than this (m, 0 = every second)", errorBound);
+  cmd.AddValue("maxSilence", "Longest time between reports when errorBound is set", maxSilence);
+  cmd.AddValue("psm", "Run the PSM/eDRX battery lifetime scenario instead of the LTE stack", psm);
+  cmd.AddValue("gps", "Run the GPS fix scheduling scenario (adaptive vs fixed and matched period) on the mobility trace", gps);
+  cmd.AddValue("massiveAccess", "Run the NPRACH massive access scenario (synchronised wake-up) instead of the LTE stack", massiveAccess);
+  cmd.AddValue("accessUes", "Comma-separated fleet sizes for the massive access scenario", accessUes);
+  cmd.AddValue("wakeSpread", "Massive access UEs wake uniformly over this long (0 = all at once)", wakeSpread);
+  cmd.AddValue("reportPeriod", "Time between position reports in PSM mode", reportPeriod);
+  cmd.AddValue("batteryMah", "Battery capacity in mAh for lifetime projection", batteryMah);
+  cmd.AddValue("supplyVoltage", "Battery supply voltage", supplyVoltage);
+  cmd.AddValue("resultsDb", "SQLite results database, relative to the ns-3 root (empty to disable)", resultsDb);
   cmd.Parse(argc, argv);
+  RngSeedManager::SetSeed(seed);
+  RngSeedManager::SetRun(run);
+
+  // Detailed logging is opt-in: at thousands of UEs the MAC/PHY debug output
+  // alone outlasts the simulated time
+  if (verbose) {
+    LogComponentEnable("LteUePhy", LOG_LEVEL_INFO);
+    LogComponentEnable("LteUeMac", LOG_LEVEL_DEBUG);
+    LogComponentEnable("LteEnbPhy", LOG_LEVEL_INFO);
+    LogComponentEnable("LteEnbMac", LOG_LEVEL_DEBUG);
+    LogComponentEnable("LteSpectrumPhy", LOG_LEVEL_DEBUG);
+    LogComponentEnable("NBIoT", LOG_LEVEL_ALL);
+  }
+
+  if (!resultsDb.empty()) {
+    std::ostringstream params;
+    params << "psm=" << psm << ";gps=" << gps << ";massiveAccess=" << massiveAccess << ";numNodes=" << numUeNodes << ";numRadioTowers=" << numEnbNodes
+           << ";simTime=" << simTime.GetSeconds() << ";packetLossRate=" << packetLossRate
+           << ";useCa=" << useCa;
+    if (!psm && !gps && !massiveAccess) {
+      params << ";enbSites=" << enbSites << ";mobilityTrace=" << mobilityTrace
+             << ";handover=" << handover << ";errorBound=" << errorBound
+             << ";maxSilence=" << maxSilence.GetSeconds();
+    }
+    if (gps) {
+      params << ";mobilityTrace=" << mobilityTrace;
+    }
+    if (massiveAccess) {
+      params << ";accessUes=" << accessUes << ";wakeSpread=" << wakeSpread.GetSeconds();
+    }
+    if (psm) {
+      params << ";reportPeriod=" << reportPeriod.GetSeconds() << ";batteryMah=" << batteryMah;
+    }
+    results.reset(new ResultsStore(resultsDb, "nb_iot", params.str(),
+                                   RngSeedManager::GetSeed(), RngSeedManager::GetRun()));
+  }
+
+  if (profile) {
+    EnableEventProfiler();
+  }
+
+  if (psm) {
+    return RunPowerSavingScenario(numUeNodes, simTime, reportPeriod, batteryMah, supplyVoltage);
+  }
+
+  if (massiveAccess) {
+    return RunMassiveAccessScenario(accessUes, wakeSpread);
+  }
+
+  if (gps) {
+    return RunGpsScenario(numUeNodes, simTime, mobilityTrace, batteryMah, supplyVoltage);
+  }
+
+  std::vector<CellSite> sites = LoadCellSites(enbSites);
+  if (numEnbNodes == 0) {
+    numEnbNodes = sites.size();
+  } else if (numEnbNodes > sites.size()) {
+    NS_FATAL_ERROR("numRadioTowers=" << numEnbNodes << " but " << enbSites
+                   << " only lists " << sites.size() << " sites");
+  }
+  sites.resize(numEnbNodes);
 
   NS_LOG_INFO("========== Simulation Configuration ==========");
   NS_LOG_INFO("UE Nodes: " << numUeNodes);
-  NS_LOG_INFO("eNB Nodes: " << numEnbNodes);
+  NS_LOG_INFO("eNB Nodes: " << numEnbNodes << " (from " << enbSites << ")");
+  NS_LOG_INFO("Handover: " << (handover ? "Enabled" : "Disabled"));
   NS_LOG_INFO("Packet Loss Rate: " << packetLossRate);
   NS_LOG_INFO("Simulation Time: " << simTime.As(Time::S));
   NS_LOG_INFO("Carrier Aggregation: " << (useCa ? "Enabled" : "Disabled"));
   NS_LOG_INFO("==============================================");
 
+  typedef std::chrono::steady_clock SetupClock;
+  auto ms = [](SetupClock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+  SetupTimer setup;
+  setup.Phase("helpers");
+
   // ==================== LTE CONFIGURATION ====================
   Ptr<LteHelper> lteHelper = CreateObject<LteHelper>();
   Ptr<PointToPointEpcHelper> epcHelper = CreateObject<PointToPointEpcHelper>();
@@ -102,7 +588,14 @@ int main (int argc, char *argv[]) {
                       StringValue("ns3::RrComponentCarrierManager"));
   }
 
+  if (handover) {
+    lteHelper->SetHandoverAlgorithmType("ns3::A3RsrpHandoverAlgorithm");
+    lteHelper->SetHandoverAlgorithmAttribute("Hysteresis", DoubleValue(3.0));
+    lteHelper->SetHandoverAlgorithmAttribute("TimeToTrigger", TimeValue(MilliSeconds(256)));
+  }
+
   // ==================== NODE CREATION ====================
+  setup.Phase("nodes");
   NS_LOG_INFO("Creating " << numEnbNodes << " eNB node(s)");
   NodeContainer enbNodes;
   enbNodes.Create(numEnbNodes);
@@ -112,46 +605,54 @@ int main (int argc, char *argv[]) {
   ueNodes.Create(numUeNodes);
 
   // ==================== MOBILITY ====================
-  MobilityHelper mobility;
-  mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-
-  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator>();
-  positionAlloc->Add(Vector(0, 0, 30));    // eNB position
-  positionAlloc->Add(Vector(50, 0, 1.5));  // UE position (50m from eNB)
-  mobility.SetPositionAllocator(positionAlloc);
-
+  setup.Phase("mobility");
   NS_LOG_INFO("Installing mobility models");
-  mobility.Install(enbNodes);
-  mobility.Install(ueNodes);
+  std::vector<Vector> enbPositions;
+  for (const CellSite &site : sites) {
+    enbPositions.push_back(Vector(site.x, site.y, site.z));
+  }
+  InstallConstantPositions(enbNodes, enbPositions);
+
+  // Trace node i drives the i-th UE; UEs beyond the trace are parked at
+  // random points inside the deployment so every cell sees some load.
+  CellGridIndex cellIndex(sites);
+  if (!mobilityTrace.empty()) {
+    Ns2MobilityHelper ns2(mobilityTrace);
+    ns2.Install(ueNodes.Begin(), ueNodes.End());
+  }
+  Ptr<UniformRandomVariable> ueX = CreateObject<UniformRandomVariable>();
+  ueX->SetAttribute("Min", DoubleValue(cellIndex.GetMinX()));
+  ueX->SetAttribute("Max", DoubleValue(cellIndex.GetMaxX()));
+  Ptr<UniformRandomVariable> ueY = CreateObject<UniformRandomVariable>();
+  ueY->SetAttribute("Min", DoubleValue(cellIndex.GetMinY()));
+  ueY->SetAttribute("Max", DoubleValue(cellIndex.GetMaxY()));
+  uint32_t tracedUes = 0;
+  for (uint32_t i = 0; i < ueNodes.GetN(); ++i) {
+    if (ueNodes.Get(i)->GetObject<MobilityModel>() != nullptr) {
+      tracedUes++;
+      continue;
+    }
+    Ptr<ConstantPositionMobilityModel> parked = CreateObject<ConstantPositionMobilityModel>();
+    parked->SetPosition(Vector(ueX->GetValue(), ueY->GetValue(), 1.5));
+    ueNodes.Get(i)->AggregateObject(parked);
+  }
+  NS_LOG_INFO(tracedUes << " UE(s) follow " << mobilityTrace << ", "
+              << ueNodes.GetN() - tracedUes << " placed at random");
+
   BuildingsHelper::Install(enbNodes);
   BuildingsHelper::Install(ueNodes);
 
   // ==================== NETWORK SETUP ====================
+  setup.Phase("devices");
   NS_LOG_INFO("Installing LTE devices");
   NetDeviceContainer enbDevs = lteHelper->InstallEnbDevice(enbNodes);
   NetDeviceContainer ueDevs = lteHelper->InstallUeDevice(ueNodes);
-
-  // ==================== TRACE CONNECTIONS ====================
-  NS_LOG_INFO("Connecting tracing callbacks");
-
-  // Connect PHY traces for all devices
-  for (uint32_t i = 0; i < ueDevs.GetN(); ++i) {
-      Ptr<LteUePhy> uePhy = ueDevs.Get(i)->GetObject<LteUeNetDevice>()->GetPhy();
-      
-      // UE transmission/reception
-      uePhy->TraceConnectWithoutContext("Tx", MakeCallback(&PhyTxTrace));
-      uePhy->TraceConnectWithoutContext("Rx", MakeCallback(&PhyRxTrace));
-  }
-
-  for (uint32_t i = 0; i < enbDevs.GetN(); ++i) {
-      Ptr<LteEnbPhy> enbPhy = enbDevs.Get(i)->GetObject<LteEnbNetDevice>()->GetPhy();
-      
-      // eNB transmission/reception
-      enbPhy->TraceConnectWithoutContext("Tx", MakeCallback(&PhyTxTrace));
-      enbPhy->TraceConnectWithoutContext("Rx", MakeCallback(&PhyRxTrace));
+  if (handover) {
+    lteHelper->AddX2Interface(enbNodes);
   }
 
   // ==================== INTERNET STACK ====================
+  setup.Phase("internet");
   NS_LOG_INFO("Installing internet stack on UEs");
   InternetStackHelper internet;
   internet.Install(ueNodes);
@@ -188,24 +689,39 @@ int main (int argc, char *argv[]) {
   Ipv4InterfaceContainer ueIpIface = epcHelper->AssignUeIpv4Address(ueDevs);
 
   // ==================== ENERGY SETUP ====================
+  setup.Phase("energy");
   NS_LOG_INFO("Configuring energy sources");
-  BasicEnergySourceHelper energySourceHelper;
-  energySourceHelper.Set("BasicEnergySourceInitialEnergyJ", DoubleValue(10000.0));
-  
   EnergySourceContainer energySources;
-  energySources.Add(energySourceHelper.Install(enbNodes));
-  energySources.Add(energySourceHelper.Install(ueNodes));
+  energySources.Add(InstallBasicEnergySources(enbNodes, 10000.0));
+  energySources.Add(InstallBasicEnergySources(ueNodes, 10000.0));
 
   // Connect energy traces
+  TraceHandle remainingEnergy(BasicEnergySource::GetTypeId(), "RemainingEnergy");
   for (EnergySourceContainer::Iterator it = energySources.Begin(); 
        it != energySources.End(); ++it) {
-    DynamicCast<BasicEnergySource>(*it)->TraceConnectWithoutContext(
-      "RemainingEnergy", MakeCallback(&EnergyConsumptionCallback));
+    remainingEnergy.Connect(*it, MakeCallback(&EnergyConsumptionCallback));
+    if (results) {
+      remainingEnergy.Connect(*it, MakeBoundCallback(&RemainingEnergySample, (*it)->GetNode()->GetId()));
+    }
   }
 
   // ==================== NETWORK ATTACHMENT ====================
-  NS_LOG_INFO("Attaching UEs to base stations");
-  lteHelper->Attach(ueDevs, enbDevs.Get(0));
+  // Initial attachment goes to the geometrically nearest site; handover
+  // takes over once UEs start moving.
+  setup.Phase("attach");
+  NS_LOG_INFO("Attaching UEs to the nearest base station");
+  TraceHandle handoverEndOk(LteUeRrc::GetTypeId(), "HandoverEndOk");
+  std::vector<uint32_t> initialLoad(enbDevs.GetN(), 0);
+  for (uint32_t i = 0; i < ueDevs.GetN(); ++i) {
+    Vector pos = ueNodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+    uint32_t cell = cellIndex.Nearest(pos.x, pos.y);
+    lteHelper->Attach(ueDevs.Get(i), enbDevs.Get(cell));
+    initialLoad[cell]++;
+    if (handover) {
+      handoverEndOk.Connect(ueDevs.Get(i)->GetObject<LteUeNetDevice>()->GetRrc(),
+                            MakeCallback(&HandoverEndOkTrace));
+    }
+  }
 
   // ==================== BEARER ACTIVATION ====================
   // NS_LOG_INFO("Activating EPS bearers");
@@ -214,6 +730,7 @@ int main (int argc, char *argv[]) {
   // lteHelper->ActivateDataRadioBearer(ueDevs, bearer);
 
   // ==================== TRAFFIC SETUP ====================
+  setup.Phase("applications");
   NS_LOG_INFO("Setting up applications");
 
   // UL Traffic from UE to remote host
@@ -223,16 +740,19 @@ int main (int argc, char *argv[]) {
   ApplicationContainer clientApps;
   ApplicationContainer serverApps;
 
-  // UDP Server on remote host
+  // UDP Server on remote host, decoding the fixes it receives
   PacketSinkHelper ulPacketSinkHelper("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), ulPort));
   serverApps.Add(ulPacketSinkHelper.Install(remoteHost));
+  serverApps.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&FixRxTrace));
 
-  // UDP Client on UE
-  UdpClientHelper ulClient(remoteHost->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal(), ulPort);
-  ulClient.SetAttribute("MaxPackets", UintegerValue(UINT32_MAX));
+  // Position reports from the UE's mobility model
+  TrackerPayloadHelper ulClient(remoteHost->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal(), ulPort);
   ulClient.SetAttribute("Interval", TimeValue(Seconds(1.0)));
   ulClient.SetAttribute("PacketSize", UintegerValue(200));
-  clientApps.Add(ulClient.Install(ueNodes.Get(0)));
+  ulClient.SetAttribute("ErrorBound", DoubleValue(errorBound));
+  ulClient.SetAttribute("MaxSilence", TimeValue(maxSilence));
+  clientApps.Add(ulClient.Install(ueNodes));
+  ScheduleLabelled("SampleReconstruction", Seconds(1.0), &SampleReconstruction, ueNodes, Seconds(1.0));
 
   // Start applications
   serverApps.Start(Seconds(0.5));
@@ -243,12 +763,107 @@ int main (int argc, char *argv[]) {
   // Enable LTE traces
   lteHelper->EnableTraces();
 
+  setup.Stop();
+  setup.Print(std::cout);
+
   // ==================== SIMULATION CONTROL ====================
   Simulator::Stop(simTime);
   NS_LOG_INFO("Starting simulation...");
   Simulator::Run();
-  
+  PrintEventProfile(std::cout, profileTop);
+
   NS_LOG_INFO("Simulation completed");
+
+  uint64_t reportsSent = 0, reportsSuppressed = 0;
+  double bytesPerSecond = 0;
+  for (uint32_t i = 0; i < clientApps.GetN(); ++i) {
+    Ptr<TrackerPayloadApplication> tracker = DynamicCast<TrackerPayloadApplication>(clientApps.Get(i));
+    reportsSent += tracker->GetReportsSent();
+    reportsSuppressed += tracker->GetReportsSuppressed();
+    bytesPerSecond += tracker->GetBytesPerSecond();
+  }
+  NS_LOG_INFO("Trackers: " << reportsSent << " reports (" << reportsSuppressed << " suppressed), "
+              << bytesPerSecond << " B/s");
+  const DistanceStats &reconstructionError = reconstruction.GetError();
+
+  // Where each UE ended up, after any handovers
+  std::map<uint16_t, uint32_t> cellToSite;
+  for (uint32_t i = 0; i < enbDevs.GetN(); ++i) {
+    cellToSite[enbDevs.Get(i)->GetObject<LteEnbNetDevice>()->GetCellId()] = i;
+  }
+  std::vector<uint32_t> finalLoad(enbDevs.GetN(), 0);
+  for (uint32_t i = 0; i < ueDevs.GetN(); ++i) {
+    auto site = cellToSite.find(ueDevs.Get(i)->GetObject<LteUeNetDevice>()->GetRrc()->GetCellId());
+    if (site != cellToSite.end()) {
+      finalLoad[site->second]++;
+    }
+  }
+  // Server-side queries over what was synced
+  auto queryStart = SetupClock::now();
+  uint32_t located = 0;
+  for (uint32_t i = 0; i < ueNodes.GetN(); ++i) {
+    TrackStore::Point last;
+    located += trackStore.GetLastLocation(ueNodes.Get(i)->GetId(), last);
+  }
+  auto lastDone = SetupClock::now();
+  std::vector<TrackStore::Point> recent;
+  int64_t nowMs = simTime.GetMilliSeconds();
+  for (uint32_t i = 0; i < ueNodes.GetN(); ++i) {
+    trackStore.QueryTimeRange(ueNodes.Get(i)->GetId(), nowMs - 60000, nowMs, recent);
+  }
+  auto rangeDone = SetupClock::now();
+  uint64_t nearSite = 0;
+  trackStore.QueryBox(sites[0].x - 1000, sites[0].y - 1000, sites[0].x + 1000, sites[0].y + 1000,
+                      0, nowMs, [&nearSite](uint64_t, const TrackStore::Point &) { nearSite++; });
+  auto boxDone = SetupClock::now();
+  NS_LOG_INFO("Track store: " << trackStore.GetSize() << " fixes from " << trackStore.GetObjectCount()
+              << " trackers, " << trackStore.GetDataBytes() << " bytes; last location for "
+              << located << " UEs in " << ms(lastDone - queryStart) << " ms, last minute of "
+              << "every UE (" << recent.size() << " fixes) in " << ms(rangeDone - lastDone)
+              << " ms, " << nearSite << " fixes within 1 km of " << sites[0].name << " in "
+              << ms(boxDone - rangeDone) << " ms");
+
+  CellLoadSummary initial = SummariseCellLoad(initialLoad);
+  CellLoadSummary current = SummariseCellLoad(finalLoad);
+
+  std::cout << "\n=== Deployment Results ===\n"
+            << "Cells: " << enbDevs.GetN() << ", UEs: " << ueDevs.GetN() << "\n"
+            << "Setup time: " << setup.GetTotalMs() << " ms (attach "
+            << setup.GetMs("attach") << " ms)\n"
+            << "Initial UEs per cell: min " << initial.minLoad << ", mean " << initial.meanLoad
+            << ", max " << initial.maxLoad << ", idle cells " << initial.idleCells
+            << ", Jain " << initial.jainIndex << "\n"
+            << "Final UEs per cell: min " << current.minLoad << ", mean " << current.meanLoad
+            << ", max " << current.maxLoad << ", idle cells " << current.idleCells
+            << ", Jain " << current.jainIndex << "\n"
+            << "Handovers: " << handovers << "\n"
+            << "Server reconstruction error: mean " << reconstructionError.GetMean() << " m, p95 "
+            << reconstructionError.GetPercentile(0.95) << " m, max " << reconstructionError.GetMax()
+            << " m (" << reportsSent << " reports, " << reportsSuppressed << " suppressed)\n";
+
+  if (results) {
+    results->AddKpi("reports_sent", reportsSent);
+    results->AddKpi("reports_suppressed", reportsSuppressed);
+    results->AddKpi("bytes_per_s", bytesPerSecond);
+    results->AddKpi("fixes_received", fixesReceived);
+    results->AddKpi("reconstruction_error_mean_m", reconstructionError.GetMean());
+    results->AddKpi("reconstruction_error_p95_m", reconstructionError.GetPercentile(0.95));
+    results->AddKpi("track_store_bytes", trackStore.GetDataBytes());
+    results->AddKpi("handovers", handovers);
+    results->AddKpi("setup_ms", setup.GetTotalMs());
+    results->AddKpi("attach_ms", setup.GetMs("attach"));
+    for (const auto &phase : setup.GetPhases()) {
+      results->AddKpi("setup_" + phase.first + "_ms", phase.second);
+    }
+    results->AddKpi("cell_load_max", current.maxLoad);
+    results->AddKpi("cell_load_jain", current.jainIndex);
+    results->AddKpi("idle_cells", current.idleCells);
+    for (uint32_t i = 0; i < finalLoad.size(); ++i) {
+      results->AddSample("cell_load", simTime.GetSeconds(), finalLoad[i], enbNodes.Get(i)->GetId());
+    }
+    results.reset();
+  }
+
   Simulator::Destroy();
 
   return 0;
@@ -0,0 +1,379 @@
+#ifndef NB_IOT_ENERGY_MODEL_H
+#define NB_IOT_ENERGY_MODEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/device-energy-model.h"
+#include "ns3/energy-source.h"
+#include "event_profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+namespace ns3 {
+
+// ==================== RADIO ENERGY MODEL ====================
+// NB-IoT UE radio energy model. Unlike the LTE PHY, which ticks every 1 ms
+// subframe, this model only changes state at RRC/NAS timer boundaries, so a UE
+// sleeping in PSM costs no events at all until its next wake-up.
+class NbIotRadioEnergyModel : public DeviceEnergyModel {
+public:
+  enum State {
+    CONNECTED_TX = 0,  // RRC connected, transmitting
+    CONNECTED,         // RRC connected, receiving / waiting for inactivity timer
+    IDLE,              // RRC idle, monitoring paging (DRX or eDRX paging window)
+    EDRX,              // RRC idle, sleeping between eDRX paging windows
+    PSM,               // Power saving mode, unreachable until next TAU/uplink
+    NUM_STATES
+  };
+
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::NbIotRadioEnergyModel")
+      .SetParent<DeviceEnergyModel>()
+      .AddConstructor<NbIotRadioEnergyModel>()
+      .AddAttribute("TxCurrentA", "Current draw while transmitting (23 dBm).",
+                    DoubleValue(0.220),
+                    MakeDoubleAccessor(&NbIotRadioEnergyModel::m_txCurrentA),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("ConnectedCurrentA", "Current draw in RRC connected without transmitting.",
+                    DoubleValue(0.046),
+                    MakeDoubleAccessor(&NbIotRadioEnergyModel::m_connectedCurrentA),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("IdleCurrentA", "Average current in RRC idle while monitoring paging.",
+                    DoubleValue(0.006),
+                    MakeDoubleAccessor(&NbIotRadioEnergyModel::m_idleCurrentA),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("EdrxCurrentA", "Current draw sleeping between eDRX paging windows.",
+                    DoubleValue(0.0002),
+                    MakeDoubleAccessor(&NbIotRadioEnergyModel::m_edrxCurrentA),
+                    MakeDoubleChecker<double>())
+      .AddAttribute("PsmCurrentA", "Current draw in power saving mode.",
+                    DoubleValue(0.000003),
+                    MakeDoubleAccessor(&NbIotRadioEnergyModel::m_psmCurrentA),
+                    MakeDoubleChecker<double>())
+      .AddTraceSource("TotalEnergyConsumption", "Total energy consumed by the radio.",
+                      MakeTraceSourceAccessor(&NbIotRadioEnergyModel::m_totalEnergyConsumption),
+                      "ns3::TracedValueCallback::Double")
+      .AddTraceSource("State", "Radio state changes (old, new).",
+                      MakeTraceSourceAccessor(&NbIotRadioEnergyModel::m_stateTrace),
+                      "ns3::NbIotRadioEnergyModel::StateTracedCallback");
+    return tid;
+  }
+
+  typedef void (*StateTracedCallback)(int oldState, int newState);
+
+  NbIotRadioEnergyModel()
+    : m_state(PSM),
+      m_lastUpdateTime(Seconds(0)),
+      m_depleted(false) {
+    m_totalEnergyConsumption = 0;
+    m_residency.fill(Seconds(0));
+  }
+
+  void SetEnergySource(Ptr<EnergySource> source) override {
+    NS_ASSERT(source != nullptr);
+    m_source = source;
+  }
+
+  double GetTotalEnergyConsumption() const override {
+    return m_totalEnergyConsumption;
+  }
+
+  void ChangeState(int newState) override {
+    NS_ASSERT(newState >= 0 && newState < NUM_STATES);
+    Accumulate();
+    if (m_source != nullptr) {
+      m_source->UpdateEnergySource();
+    }
+    int oldState = m_state;
+    m_state = static_cast<State>(newState);
+    m_stateTrace(oldState, newState);
+  }
+
+  void HandleEnergyDepletion() override {
+    m_depleted = true;
+  }
+
+  void HandleEnergyRecharged() override {
+    m_depleted = false;
+  }
+
+  void HandleEnergyChanged() override {}
+
+  State GetState() const { return m_state; }
+  bool IsDepleted() const { return m_depleted; }
+
+  double GetStateCurrentA(int state) const {
+    switch (state) {
+      case CONNECTED_TX: return m_txCurrentA;
+      case CONNECTED: return m_connectedCurrentA;
+      case IDLE: return m_idleCurrentA;
+      case EDRX: return m_edrxCurrentA;
+      default: return m_psmCurrentA;
+    }
+  }
+
+  // Time spent in the given state up to now.
+  Time GetResidency(State state) const {
+    Time residency = m_residency[state];
+    if (state == m_state) {
+      residency += Simulator::Now() - m_lastUpdateTime;
+    }
+    return residency;
+  }
+
+  static std::string GetStateName(int state) {
+    static const char *names[NUM_STATES] = {"CONNECTED_TX", "CONNECTED", "IDLE", "EDRX", "PSM"};
+    return names[state];
+  }
+
+private:
+  double DoGetCurrentA() const override {
+    return GetStateCurrentA(m_state);
+  }
+
+  // Charges the energy spent in the current state since the last update.
+  void Accumulate() {
+    Time duration = Simulator::Now() - m_lastUpdateTime;
+    double voltage = m_source != nullptr ? m_source->GetSupplyVoltage() : 0.0;
+    m_totalEnergyConsumption += duration.GetSeconds() * GetStateCurrentA(m_state) * voltage;
+    m_residency[m_state] += duration;
+    m_lastUpdateTime = Simulator::Now();
+  }
+
+  Ptr<EnergySource> m_source;
+  State m_state;
+  double m_txCurrentA;
+  double m_connectedCurrentA;
+  double m_idleCurrentA;
+  double m_edrxCurrentA;
+  double m_psmCurrentA;
+  std::array<Time, NUM_STATES> m_residency;
+  Time m_lastUpdateTime;
+  bool m_depleted;
+  TracedValue<double> m_totalEnergyConsumption;
+  TracedCallback<int, int> m_stateTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(NbIotRadioEnergyModel);
+
+// ==================== POWER SAVING CONTROLLER ====================
+// Drives an NbIotRadioEnergyModel through the NB-IoT reporting cycle:
+//
+//   wake -> connection setup -> uplink -> RRC inactivity -> idle for T3324
+//   (eDRX paging windows if enabled) -> PSM until the next report or the
+//   periodic TAU (T3412), whichever comes first.
+//
+// Every transition is a single scheduled event, so simulated days cost a
+// handful of events per report instead of one per subframe.
+class NbIotPowerSavingController : public Object {
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::NbIotPowerSavingController")
+      .SetParent<Object>()
+      .AddConstructor<NbIotPowerSavingController>()
+      .AddAttribute("ReportPeriod", "Time between uplink position reports.",
+                    TimeValue(Minutes(15)),
+                    MakeTimeAccessor(&NbIotPowerSavingController::m_reportPeriod),
+                    MakeTimeChecker())
+      .AddAttribute("PsmEnabled", "Enter PSM once T3324 expires.",
+                    BooleanValue(true),
+                    MakeBooleanAccessor(&NbIotPowerSavingController::m_psmEnabled),
+                    MakeBooleanChecker())
+      .AddAttribute("T3324", "Active timer: idle time before entering PSM.",
+                    TimeValue(Seconds(60)),
+                    MakeTimeAccessor(&NbIotPowerSavingController::m_t3324),
+                    MakeTimeChecker())
+      .AddAttribute("T3412", "Periodic TAU timer: longest stay in PSM.",
+                    TimeValue(Hours(24)),
+                    MakeTimeAccessor(&NbIotPowerSavingController::m_t3412),
+                    MakeTimeChecker())
+      .AddAttribute("EdrxCycle", "eDRX cycle length (zero disables eDRX).",
+                    TimeValue(Seconds(20.48)),
+                    MakeTimeAccessor(&NbIotPowerSavingController::m_edrxCycle),
+                    MakeTimeChecker())
+      .AddAttribute("PagingTimeWindow", "Paging time window at the start of each eDRX cycle.",
+                    TimeValue(Seconds(2.56)),
+                    MakeTimeAccessor(&NbIotPowerSavingController::m_ptw),
+                    MakeTimeChecker())
+      .AddAttribute("InactivityTimer", "RRC inactivity time before release to idle.",
+                    TimeValue(Seconds(20)),
+                    MakeTimeAccessor(&NbIotPowerSavingController::m_inactivityTimer),
+                    MakeTimeChecker())
+      .AddAttribute("ConnectionSetupTime", "Random access plus RRC connection setup.",
+                    TimeValue(MilliSeconds(1500)),
+                    MakeTimeAccessor(&NbIotPowerSavingController::m_setupTime),
+                    MakeTimeChecker())
+      .AddAttribute("TauTime", "Time connected for a periodic tracking area update.",
+                    TimeValue(MilliSeconds(1000)),
+                    MakeTimeAccessor(&NbIotPowerSavingController::m_tauTime),
+                    MakeTimeChecker())
+      .AddAttribute("PacketSize", "Uplink report size in bytes.",
+                    UintegerValue(200),
+                    MakeUintegerAccessor(&NbIotPowerSavingController::m_packetSize),
+                    MakeUintegerChecker<uint32_t>())
+      .AddAttribute("UplinkRate", "Effective uplink rate including repetitions (bit/s).",
+                    DoubleValue(20000),
+                    MakeDoubleAccessor(&NbIotPowerSavingController::m_uplinkRate),
+                    MakeDoubleChecker<double>(1));
+    return tid;
+  }
+
+  NbIotPowerSavingController()
+    : m_reportsSent(0),
+      m_tausSent(0) {}
+
+  void SetRadioEnergyModel(Ptr<NbIotRadioEnergyModel> model) {
+    m_model = model;
+  }
+
+  // Starts the reporting cycle with the UE asleep in PSM.
+  void Start(Time at) {
+    NS_ABORT_MSG_IF(!m_edrxCycle.IsZero() && m_edrxCycle < m_ptw,
+                    "EdrxCycle (" << m_edrxCycle.As(Time::S) << ") is shorter than PagingTimeWindow ("
+                    << m_ptw.As(Time::S) << ")");
+    m_model->ChangeState(NbIotRadioEnergyModel::PSM);
+    m_nextReport = Simulator::Now() + at;
+    Sleep();
+  }
+
+  uint32_t GetReportsSent() const { return m_reportsSent; }
+  uint32_t GetTausSent() const { return m_tausSent; }
+
+  Time GetTxTime() const {
+    return Seconds(m_packetSize * 8.0 / m_uplinkRate);
+  }
+
+  // Battery lifetime if the consumption observed so far is sustained.
+  Time ProjectLifetime(double batteryEnergyJ) const {
+    double consumed = m_model->GetTotalEnergyConsumption();
+    double elapsed = Simulator::Now().GetSeconds();
+    if (consumed <= 0 || elapsed <= 0) {
+      return Time::Max();
+    }
+    return Seconds(batteryEnergyJ * elapsed / consumed);
+  }
+
+protected:
+  void DoDispose() override {
+    m_event.Cancel();
+    m_model = nullptr;
+    Object::DoDispose();
+  }
+
+private:
+  // Report cycle: setup -> tx -> inactivity -> idle.
+  void Wake() {
+    if (m_model->IsDepleted()) {
+      return;
+    }
+    m_model->ChangeState(NbIotRadioEnergyModel::CONNECTED);
+    m_event = ScheduleLabelled("NbIotPowerSavingController::Transmit",
+                               m_setupTime, &NbIotPowerSavingController::Transmit, this);
+  }
+
+  void Transmit() {
+    m_model->ChangeState(NbIotRadioEnergyModel::CONNECTED_TX);
+    m_reportsSent++;
+    m_nextReport += m_reportPeriod;
+    m_event = ScheduleLabelled("NbIotPowerSavingController::WaitInactivity",
+                               GetTxTime(), &NbIotPowerSavingController::WaitInactivity, this);
+  }
+
+  void WaitInactivity() {
+    m_model->ChangeState(NbIotRadioEnergyModel::CONNECTED);
+    m_event = ScheduleLabelled("NbIotPowerSavingController::EnterIdle",
+                               m_inactivityTimer, &NbIotPowerSavingController::EnterIdle, this);
+  }
+
+  void TrackingAreaUpdate() {
+    if (m_model->IsDepleted()) {
+      return;
+    }
+    m_model->ChangeState(NbIotRadioEnergyModel::CONNECTED);
+    m_tausSent++;
+    m_event = ScheduleLabelled("NbIotPowerSavingController::EnterIdle",
+                               m_tauTime, &NbIotPowerSavingController::EnterIdle, this);
+  }
+
+  // Idle phase: stays reachable for T3324 (or until the next report when PSM
+  // is disabled), alternating paging windows and eDRX sleep.
+  void EnterIdle() {
+    m_lastActive = Simulator::Now();
+    m_idleEnd = m_psmEnabled ? std::min(Simulator::Now() + m_t3324, m_nextReport) : m_nextReport;
+    PagingWindow();
+  }
+
+  void PagingWindow() {
+    Time now = Simulator::Now();
+    if (now >= m_idleEnd) {
+      Sleep();
+      return;
+    }
+    m_model->ChangeState(NbIotRadioEnergyModel::IDLE);
+    if (m_edrxCycle.IsZero()) {
+      m_event = ScheduleLabelled("NbIotPowerSavingController::PagingWindow",
+                                 m_idleEnd - now, &NbIotPowerSavingController::PagingWindow, this);
+      return;
+    }
+    Time ptwEnd = std::min(now + m_ptw, m_idleEnd);
+    m_event = ScheduleLabelled("NbIotPowerSavingController::EdrxSleep",
+                               ptwEnd - now, &NbIotPowerSavingController::EdrxSleep, this);
+  }
+
+  void EdrxSleep() {
+    Time now = Simulator::Now();
+    if (now >= m_idleEnd) {
+      Sleep();
+      return;
+    }
+    m_model->ChangeState(NbIotRadioEnergyModel::EDRX);
+    Time cycleEnd = std::min(now + m_edrxCycle - m_ptw, m_idleEnd);
+    m_event = ScheduleLabelled("NbIotPowerSavingController::PagingWindow",
+                               cycleEnd - now, &NbIotPowerSavingController::PagingWindow, this);
+  }
+
+  // Deep sleep until the next report, waking early for periodic TAU.
+  void Sleep() {
+    Time now = Simulator::Now();
+    if (now >= m_nextReport) {
+      Wake();
+      return;
+    }
+    m_model->ChangeState(NbIotRadioEnergyModel::PSM);
+    Time tau = m_lastActive + m_t3412;
+    if (m_psmEnabled && tau < m_nextReport) {
+      m_event = ScheduleLabelled("NbIotPowerSavingController::TrackingAreaUpdate",
+                                 tau - now, &NbIotPowerSavingController::TrackingAreaUpdate, this);
+    } else {
+      m_event = ScheduleLabelled("NbIotPowerSavingController::Wake",
+                                 m_nextReport - now, &NbIotPowerSavingController::Wake, this);
+    }
+  }
+
+  Ptr<NbIotRadioEnergyModel> m_model;
+  EventId m_event;
+  Time m_reportPeriod;
+  bool m_psmEnabled;
+  Time m_t3324;
+  Time m_t3412;
+  Time m_edrxCycle;
+  Time m_ptw;
+  Time m_inactivityTimer;
+  Time m_setupTime;
+  Time m_tauTime;
+  uint32_t m_packetSize;
+  double m_uplinkRate;
+
+  Time m_nextReport;
+  Time m_idleEnd;
+  Time m_lastActive;
+  uint32_t m_reportsSent;
+  uint32_t m_tausSent;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(NbIotPowerSavingController);
+
+} // namespace ns3
+
+#endif /* NB_IOT_ENERGY_MODEL_H */
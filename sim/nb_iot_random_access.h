@@ -0,0 +1,268 @@
+#ifndef NB_IOT_RANDOM_ACCESS_H
+#define NB_IOT_RANDOM_ACCESS_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== NPRACH CONTENTION ====================
+// NB-IoT random access for a crowd of UEs, without the rest of the stack.
+// Each carrier (the anchor plus NonAnchorCarriers, Rel-14) has an NPRACH
+// opportunity every NprachPeriod with Subcarriers single-tone preambles. A
+// UE picks a carrier (CarrierPolicy) and a random subcarrier at the next
+// opportunity; a preamble chosen by more than one UE collides and all of
+// them fail contention resolution. Failed UEs learn it ResponseDelay after
+// the preamble (no RAR / no Msg4), back off uniformly over BackoffWindow and
+// retry, up to MaxAttempts preambles in total.
+//
+// Only opportunities someone is waiting for get an event, so a burst of 50k
+// synchronised UEs costs one event per wake-up plus one per busy opportunity.
+//
+// Carrier policies:
+//   AnchorOnly   everything on the anchor carrier (pre-Rel-14 behaviour)
+//   Random       uniform over carriers, per attempt (Rel-14 probabilities
+//                with equal NPRACH resources on every carrier)
+//   LeastLoaded  the carrier whose next opportunity has the fewest UEs
+//                queued, i.e. ideal network-assisted balancing
+class NbIotRandomAccess : public Object {
+public:
+  enum CarrierPolicy { ANCHOR_ONLY, RANDOM, LEAST_LOADED };
+
+  struct CarrierStats {
+    uint64_t opportunities;  // opportunities with at least one preamble
+    uint64_t preambles;
+    uint64_t used;           // distinct subcarriers transmitted on
+    uint64_t collided;       // preambles that shared their subcarrier
+    uint64_t successes;
+  };
+
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::NbIotRandomAccess")
+      .SetParent<Object>()
+      .AddConstructor<NbIotRandomAccess>()
+      .AddAttribute("NonAnchorCarriers", "Non-anchor carriers with NPRACH resources besides the anchor.",
+                    UintegerValue(2),
+                    MakeUintegerAccessor(&NbIotRandomAccess::m_nonAnchorCarriers),
+                    MakeUintegerChecker<uint32_t>())
+      .AddAttribute("NprachPeriod", "Time between NPRACH opportunities on a carrier.",
+                    TimeValue(MilliSeconds(40)),
+                    MakeTimeAccessor(&NbIotRandomAccess::m_period),
+                    MakeTimeChecker())
+      .AddAttribute("Subcarriers", "Preambles (single-tone subcarriers) per NPRACH opportunity.",
+                    UintegerValue(48),
+                    MakeUintegerAccessor(&NbIotRandomAccess::m_subcarriers),
+                    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("PreambleDuration", "NPRACH preamble length (format 0, one repetition).",
+                    TimeValue(MicroSeconds(6400)),
+                    MakeTimeAccessor(&NbIotRandomAccess::m_preambleDuration),
+                    MakeTimeChecker())
+      .AddAttribute("ResponseDelay", "From the end of the preamble to Msg4 (RAR window, Msg3, contention resolution).",
+                    TimeValue(MilliSeconds(100)),
+                    MakeTimeAccessor(&NbIotRandomAccess::m_responseDelay),
+                    MakeTimeChecker())
+      .AddAttribute("BackoffWindow", "Backoff after a failed attempt is uniform over [0, BackoffWindow).",
+                    TimeValue(MilliSeconds(1024)),
+                    MakeTimeAccessor(&NbIotRandomAccess::m_backoffWindow),
+                    MakeTimeChecker())
+      .AddAttribute("MaxAttempts", "Preambles a UE sends before declaring random access failed.",
+                    UintegerValue(10),
+                    MakeUintegerAccessor(&NbIotRandomAccess::m_maxAttempts),
+                    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("CarrierPolicy", "How a UE chooses the carrier for each attempt.",
+                    EnumValue(RANDOM),
+                    MakeEnumAccessor(&NbIotRandomAccess::m_policy),
+                    MakeEnumChecker(ANCHOR_ONLY, "AnchorOnly",
+                                    RANDOM, "Random",
+                                    LEAST_LOADED, "LeastLoaded"));
+    return tid;
+  }
+
+  NbIotRandomAccess()
+    : m_nonAnchorCarriers(2),
+      m_subcarriers(48),
+      m_maxAttempts(10),
+      m_policy(RANDOM),
+      m_failures(0) {
+    m_uniform = CreateObject<UniformRandomVariable>();
+  }
+
+  // Wakes `ues` UEs uniformly over [at, at + spread), all of them at `at`
+  // when spread is zero (e.g. coverage coming back after an outage).
+  void Start(uint32_t ues, Time at, Time spread) {
+    m_carriers.assign(GetCarriers(), CarrierStats{0, 0, 0, 0, 0});
+    m_pending.assign(GetCarriers(), std::map<int64_t, std::vector<uint32_t>>());
+    m_attempts.assign(ues, 0);
+    m_wake.resize(ues);
+    m_delays.clear();
+    m_delays.reserve(ues);
+    m_failures = 0;
+    m_firstWake = Simulator::Now() + at;
+    m_lastActivity = m_firstWake;
+    for (uint32_t ue = 0; ue < ues; ++ue) {
+      m_wake[ue] = at + Seconds(spread.IsZero() ? 0.0 : m_uniform->GetValue(0, spread.GetSeconds()));
+      Simulator::Schedule(m_wake[ue], &NbIotRandomAccess::Attempt, this, ue);
+      m_wake[ue] += Simulator::Now();
+    }
+  }
+
+  uint32_t GetCarriers() const { return 1 + m_nonAnchorCarriers; }
+  const CarrierStats &GetCarrierStats(uint32_t carrier) const { return m_carriers[carrier]; }
+
+  // Wake-up to contention resolution, for the UEs that got through.
+  const std::vector<Time> &GetAccessDelays() const { return m_delays; }
+  uint32_t GetFailures() const { return m_failures; }
+
+  uint64_t GetPreambles() const {
+    uint64_t n = 0;
+    for (const CarrierStats &c : m_carriers) {
+      n += c.preambles;
+    }
+    return n;
+  }
+
+  uint64_t GetCollidedPreambles() const {
+    uint64_t n = 0;
+    for (const CarrierStats &c : m_carriers) {
+      n += c.collided;
+    }
+    return n;
+  }
+
+  // Fraction of the carrier's preambles, over the time anyone was trying to
+  // get in, that at least one UE transmitted on.
+  double GetUtilisation(uint32_t carrier) const {
+    double opportunities = std::floor((m_lastActivity - m_firstWake).GetSeconds() / m_period.GetSeconds()) + 1;
+    return m_carriers[carrier].used / (opportunities * m_subcarriers);
+  }
+
+  // When the last UE got through or gave up.
+  Time GetLastActivity() const { return m_lastActivity; }
+
+  static std::string GetPolicyName(int policy) {
+    switch (policy) {
+      case ANCHOR_ONLY: return "AnchorOnly";
+      case RANDOM: return "Random";
+      default: return "LeastLoaded";
+    }
+  }
+
+private:
+  // Carriers' opportunities are staggered evenly within the period.
+  Time GetOffset(uint32_t carrier) const {
+    return NanoSeconds(m_period.GetNanoSeconds() * carrier / GetCarriers());
+  }
+
+  int64_t NextOpportunity(uint32_t carrier, Time t) const {
+    int64_t since = (t - GetOffset(carrier)).GetNanoSeconds();
+    int64_t period = m_period.GetNanoSeconds();
+    return since <= 0 ? 0 : (since + period - 1) / period;
+  }
+
+  Time GetOpportunityTime(uint32_t carrier, int64_t opportunity) const {
+    return GetOffset(carrier) + NanoSeconds(m_period.GetNanoSeconds() * opportunity);
+  }
+
+  uint32_t ChooseCarrier(Time now) {
+    switch (m_policy) {
+      case ANCHOR_ONLY:
+        return 0;
+      case RANDOM:
+        return m_uniform->GetInteger(0, GetCarriers() - 1);
+      default: {
+        uint32_t best = 0;
+        std::size_t bestQueued = 0;
+        for (uint32_t c = 0; c < GetCarriers(); ++c) {
+          auto found = m_pending[c].find(NextOpportunity(c, now));
+          std::size_t queued = found == m_pending[c].end() ? 0 : found->second.size();
+          if (c == 0 || queued < bestQueued) {
+            best = c;
+            bestQueued = queued;
+          }
+        }
+        return best;
+      }
+    }
+  }
+
+  // Queues the UE for the next opportunity on the carrier it picks.
+  void Attempt(uint32_t ue) {
+    Time now = Simulator::Now();
+    uint32_t carrier = ChooseCarrier(now);
+    int64_t opportunity = NextOpportunity(carrier, now);
+    std::vector<uint32_t> &queued = m_pending[carrier][opportunity];
+    if (queued.empty()) {
+      Simulator::Schedule(GetOpportunityTime(carrier, opportunity) - now,
+                          &NbIotRandomAccess::Opportunity, this, carrier, opportunity);
+    }
+    queued.push_back(ue);
+  }
+
+  void Opportunity(uint32_t carrier, int64_t opportunity) {
+    auto found = m_pending[carrier].find(opportunity);
+    std::vector<uint32_t> ues;
+    ues.swap(found->second);
+    m_pending[carrier].erase(found);
+
+    m_choice.resize(ues.size());
+    m_count.assign(m_subcarriers, 0);
+    CarrierStats &stats = m_carriers[carrier];
+    for (std::size_t i = 0; i < ues.size(); ++i) {
+      m_choice[i] = m_uniform->GetInteger(0, m_subcarriers - 1);
+      stats.used += m_count[m_choice[i]]++ == 0;
+    }
+
+    stats.opportunities++;
+    stats.preambles += ues.size();
+    Time done = Simulator::Now() + m_preambleDuration + m_responseDelay;
+    m_lastActivity = std::max(m_lastActivity, done);
+    for (std::size_t i = 0; i < ues.size(); ++i) {
+      uint32_t ue = ues[i];
+      m_attempts[ue]++;
+      if (m_count[m_choice[i]] == 1) {
+        stats.successes++;
+        m_delays.push_back(done - m_wake[ue]);
+        continue;
+      }
+      stats.collided++;
+      if (m_attempts[ue] >= m_maxAttempts) {
+        m_failures++;
+        continue;
+      }
+      Time backoff = Seconds(m_uniform->GetValue(0, m_backoffWindow.GetSeconds()));
+      Simulator::Schedule(done - Simulator::Now() + backoff, &NbIotRandomAccess::Attempt, this, ue);
+    }
+  }
+
+  uint32_t m_nonAnchorCarriers;
+  Time m_period;
+  uint32_t m_subcarriers;
+  Time m_preambleDuration;
+  Time m_responseDelay;
+  Time m_backoffWindow;
+  uint32_t m_maxAttempts;
+  int m_policy;
+  Ptr<UniformRandomVariable> m_uniform;
+
+  std::vector<CarrierStats> m_carriers;
+  std::vector<std::map<int64_t, std::vector<uint32_t>>> m_pending;  // per carrier, by opportunity
+  std::vector<uint32_t> m_attempts;
+  std::vector<Time> m_wake;
+  std::vector<Time> m_delays;
+  std::vector<uint32_t> m_choice;
+  std::vector<uint32_t> m_count;
+  uint32_t m_failures;
+  Time m_firstWake;
+  Time m_lastActivity;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(NbIotRandomAccess);
+
+} // namespace ns3
+
+#endif /* NB_IOT_RANDOM_ACCESS_H */
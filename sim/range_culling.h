@@ -0,0 +1,301 @@
+#ifndef RANGE_CULLING_H
+#define RANGE_CULLING_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/propagation-loss-model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== USEFUL RANGE ====================
+// Horizontal distance beyond which a transmission at txPowerDbm arrives below
+// thresholdDbm, found by bisection on the loss model. Assumes loss does not
+// decrease with distance, which holds for the deterministic models the sims
+// use (LogDistance, Friis, ...); with random shadowing in the chain, lower
+// the threshold by the shadowing margin. Returns maxRange if the signal is
+// still above the threshold there.
+inline double FindUsefulRange(Ptr<PropagationLossModel> loss, double txPowerDbm,
+                              double thresholdDbm, double maxRange = 1e6) {
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel>();
+  Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel>();
+  a->SetPosition(Vector(0, 0, 0));
+  b->SetPosition(Vector(maxRange, 0, 0));
+  if (loss->CalcRxPower(txPowerDbm, a, b) >= thresholdDbm) {
+    return maxRange;
+  }
+  double lo = 0, hi = maxRange;
+  while (hi - lo > 0.5) {
+    double mid = 0.5 * (lo + hi);
+    b->SetPosition(Vector(mid, 0, 0));
+    if (loss->CalcRxPower(txPowerDbm, a, b) >= thresholdDbm) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return hi;
+}
+
+// ==================== RECEIVER GRID ====================
+// The PHYs attached to a channel, bucketed on a uniform grid by position, so
+// a transmission only has to look at the buckets within its useful range
+// instead of every PHY. A channel subclass registers its PHYs with Add() and
+// asks for candidates with ForEachCandidate(); everything not returned is
+// guaranteed to be further away than the range asked for.
+//
+// Positions are kept up to date incrementally: a CourseChange re-buckets just
+// that receiver, and receivers moving at constant velocity (which fire no
+// events in between) are re-bucketed every RefreshInterval. Until then a
+// receiver can have drifted at most maxSpeed x (now - last refresh) from
+// where it is filed, and queries widen the range by that much.
+//
+// Candidates are returned in Add() order, the order the stock channels walk
+// their PHY list, so receptions scheduled for the same instant keep their
+// relative order and a run where nothing gets culled is unchanged.
+template <typename Phy>
+class ReceiverGrid {
+public:
+  ReceiverGrid(double cellSize, Time refreshInterval)
+    : m_cellSize(cellSize),
+      m_refreshInterval(refreshInterval),
+      m_lastRefresh(Seconds(0)),
+      m_maxSpeed(0),
+      m_queries(0),
+      m_candidates(0) {}
+
+  // Cell size can only change while the grid is empty.
+  void SetCellSize(double cellSize) {
+    NS_ASSERT(m_entries.empty());
+    m_cellSize = cellSize;
+  }
+
+  double GetCellSize() const { return m_cellSize; }
+
+  void Add(Ptr<Phy> phy, Ptr<MobilityModel> mobility) {
+    NS_ASSERT(m_cellSize > 0);
+    uint32_t id = m_entries.size();
+    Entry entry;
+    entry.phy = phy;
+    entry.mobility = mobility;
+    entry.key = 0;
+    entry.slot = NOT_FILED;
+    entry.moving = false;
+    m_entries.push_back(entry);
+    std::vector<uint32_t> &sharing = m_byMobility[PeekPointer(mobility)];
+    sharing.push_back(id);
+    if (sharing.size() == 1) {
+      mobility->TraceConnectWithoutContext("CourseChange",
+                                           MakeCallback(&ReceiverGrid::CourseChanged, this));
+    }
+    File(id);
+  }
+
+  // Calls fn(phy, mobility) for every receiver that may be within `range`
+  // metres (horizontally) of `position`.
+  template <typename Fn>
+  void ForEachCandidate(const Vector &position, double range, Fn fn) {
+    Refresh();
+    double radius = range + m_maxSpeed * (Simulator::Now() - m_lastRefresh).GetSeconds();
+    int64_t col = Col(position.x);
+    int64_t row = Row(position.y);
+    int64_t rings = static_cast<int64_t>(std::ceil(radius / m_cellSize));
+    m_found.clear();
+    for (int64_t r = row - rings; r <= row + rings; ++r) {
+      for (int64_t c = col - rings; c <= col + rings; ++c) {
+        auto bucket = m_buckets.find(Key(c, r));
+        if (bucket == m_buckets.end()) {
+          continue;
+        }
+        for (uint32_t id : bucket->second) {
+          double dx = m_entries[id].x - position.x;
+          double dy = m_entries[id].y - position.y;
+          if (dx * dx + dy * dy <= radius * radius) {
+            m_found.push_back(id);
+          }
+        }
+      }
+    }
+    std::sort(m_found.begin(), m_found.end());
+    m_queries++;
+    m_candidates += m_found.size();
+    for (uint32_t id : m_found) {
+      fn(m_entries[id].phy, m_entries[id].mobility);
+    }
+  }
+
+  std::size_t GetSize() const { return m_entries.size(); }
+  uint64_t GetQueries() const { return m_queries; }
+
+  // Receivers looked at per transmission, on average.
+  double GetMeanCandidates() const {
+    return m_queries > 0 ? static_cast<double>(m_candidates) / m_queries : 0.0;
+  }
+
+private:
+  struct Entry {
+    Ptr<Phy> phy;
+    Ptr<MobilityModel> mobility;
+    double x;
+    double y;
+    int64_t key;
+    uint32_t slot;  // index inside m_buckets[key]
+    bool moving;
+  };
+
+  int64_t Col(double x) const { return static_cast<int64_t>(std::floor(x / m_cellSize)); }
+  int64_t Row(double y) const { return static_cast<int64_t>(std::floor(y / m_cellSize)); }
+  static int64_t Key(int64_t col, int64_t row) {
+    return static_cast<int64_t>((static_cast<uint64_t>(row) << 32) ^ (static_cast<uint64_t>(col) & 0xffffffff));
+  }
+
+  // Files (or re-files) an entry at its current position.
+  void File(uint32_t id) {
+    Entry &e = m_entries[id];
+    Vector position = e.mobility->GetPosition();
+    Vector velocity = e.mobility->GetVelocity();
+    double speed = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+    e.x = position.x;
+    e.y = position.y;
+    if (speed > 0 && !e.moving) {
+      m_moving.push_back(id);
+    }
+    e.moving = speed > 0;
+    m_maxSpeed = std::max(m_maxSpeed, speed);
+
+    int64_t key = Key(Col(e.x), Row(e.y));
+    bool filed = e.slot != NOT_FILED;
+    if (filed && key == e.key) {
+      return;
+    }
+    if (filed) {
+      std::vector<uint32_t> &old = m_buckets[e.key];
+      m_entries[old.back()].slot = e.slot;
+      old[e.slot] = old.back();
+      old.pop_back();
+      if (old.empty()) {
+        m_buckets.erase(e.key);
+      }
+    }
+    std::vector<uint32_t> &bucket = m_buckets[key];
+    e.key = key;
+    e.slot = bucket.size();
+    bucket.push_back(id);
+  }
+
+  void CourseChanged(Ptr<const MobilityModel> mobility) {
+    auto found = m_byMobility.find(PeekPointer(mobility));
+    if (found == m_byMobility.end()) {
+      return;
+    }
+    for (uint32_t id : found->second) {
+      File(id);
+    }
+  }
+
+  // Re-files everything that moved since the last refresh and recomputes the
+  // drift bound from the receivers still moving.
+  void Refresh() {
+    Time now = Simulator::Now();
+    if (now - m_lastRefresh < m_refreshInterval) {
+      return;
+    }
+    std::vector<uint32_t> moving;
+    moving.swap(m_moving);
+    m_maxSpeed = 0;
+    for (uint32_t id : moving) {
+      m_entries[id].moving = false;
+      File(id);
+    }
+    m_lastRefresh = now;
+  }
+
+  static const uint32_t NOT_FILED = 0xffffffff;
+
+  double m_cellSize;
+  Time m_refreshInterval;
+  Time m_lastRefresh;
+  double m_maxSpeed;
+  std::vector<Entry> m_entries;
+  std::unordered_map<int64_t, std::vector<uint32_t>> m_buckets;
+  std::unordered_map<const MobilityModel *, std::vector<uint32_t>> m_byMobility;
+  std::vector<uint32_t> m_moving;
+  std::vector<uint32_t> m_found;
+  uint64_t m_queries;
+  uint64_t m_candidates;
+};
+
+// ==================== CULLED DELIVERY ====================
+// What a range-culled channel keeps next to the stock one: the receiver grid
+// and the useful range per TX power. The PHY helpers register PHYs through
+// the channel's non-virtual Add(), so the grid is filled lazily from the
+// channel's own list (PHYs are only appended) before each transmission.
+template <typename Phy>
+class CulledDelivery {
+public:
+  CulledDelivery()
+    : m_grid(0, Seconds(0)),
+      m_thresholdDbm(0),
+      m_configured(false) {}
+
+  bool IsConfigured() const { return m_configured; }
+
+  // A cellSize of 0 sizes the cells to the useful range at txPowerDbm.
+  void Configure(Ptr<PropagationLossModel> loss, double thresholdDbm, double cellSize,
+                 Time refreshInterval, double txPowerDbm) {
+    m_loss = loss;
+    m_thresholdDbm = thresholdDbm;
+    if (cellSize <= 0) {
+      cellSize = std::max(GetRange(txPowerDbm), 1.0);
+    }
+    m_grid = ReceiverGrid<Phy>(cellSize, refreshInterval);
+    m_configured = true;
+  }
+
+  // Files the PHYs added since the last call; getPhy(i) is the channel's
+  // i-th PHY.
+  template <typename GetPhy>
+  void Sync(std::size_t nPhys, GetPhy getPhy) {
+    for (std::size_t i = m_grid.GetSize(); i < nPhys; ++i) {
+      Ptr<Phy> phy = getPhy(i);
+      m_grid.Add(phy, phy->GetMobility());
+    }
+  }
+
+  double GetRange(double txPowerDbm) {
+    auto found = m_ranges.find(txPowerDbm);
+    if (found != m_ranges.end()) {
+      return found->second;
+    }
+    double range = FindUsefulRange(m_loss, txPowerDbm, m_thresholdDbm);
+    m_ranges[txPowerDbm] = range;
+    return range;
+  }
+
+  // Calls fn(phy, mobility) for the receivers a transmission from `sender`
+  // at txPowerDbm can reach above the threshold (and possibly a few more).
+  template <typename Fn>
+  void ForEachReceiver(Ptr<MobilityModel> sender, double txPowerDbm, Fn fn) {
+    m_grid.ForEachCandidate(sender->GetPosition(), GetRange(txPowerDbm), fn);
+  }
+
+  const ReceiverGrid<Phy> &GetGrid() const { return m_grid; }
+
+private:
+  ReceiverGrid<Phy> m_grid;
+  Ptr<PropagationLossModel> m_loss;
+  double m_thresholdDbm;
+  std::map<double, double> m_ranges;
+  bool m_configured;
+};
+
+} // namespace ns3
+
+#endif /* RANGE_CULLING_H */
@@ -0,0 +1,258 @@
+#ifndef REPLICATION_RUNNER_H
+#define REPLICATION_RUNNER_H
+
+#include "ns3/core-module.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== KPI STATISTICS ====================
+// Running mean/variance of one KPI across replications (Welford's method, so
+// no sample has to be kept around).
+class KpiAccumulator {
+public:
+  KpiAccumulator() : m_n(0), m_mean(0.0), m_m2(0.0) {}
+
+  void Add(double x) {
+    m_n++;
+    double delta = x - m_mean;
+    m_mean += delta / m_n;
+    m_m2 += delta * (x - m_mean);
+  }
+
+  uint32_t GetN() const { return m_n; }
+  double GetMean() const { return m_mean; }
+  double GetVariance() const { return m_n > 1 ? m_m2 / (m_n - 1) : 0.0; }
+
+  // Half-width of the two-sided Student-t confidence interval of the mean.
+  double GetHalfWidth(double confidence) const {
+    if (m_n < 2) {
+      return std::numeric_limits<double>::infinity();
+    }
+    double p = 0.5 + confidence / 2.0;
+    return StudentTQuantile(p, m_n - 1) * std::sqrt(GetVariance() / m_n);
+  }
+
+  // Full interval width relative to |mean|. A KPI that is identically zero
+  // across replications has converged by definition.
+  double GetRelativeWidth(double confidence) const {
+    double halfWidth = GetHalfWidth(confidence);
+    if (std::fabs(m_mean) < std::numeric_limits<double>::epsilon()) {
+      return halfWidth == 0.0 ? 0.0 : std::numeric_limits<double>::infinity();
+    }
+    return 2.0 * halfWidth / std::fabs(m_mean);
+  }
+
+  static double NormalQuantile(double p) {
+    // Bisection on the CDF; only called once per convergence check.
+    double lo = -10.0, hi = 10.0;
+    for (int i = 0; i < 100; ++i) {
+      double mid = 0.5 * (lo + hi);
+      if (0.5 * std::erfc(-mid / std::sqrt(2.0)) < p) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    return 0.5 * (lo + hi);
+  }
+
+  static double StudentTQuantile(double p, uint32_t dof) {
+    if (dof == 1) {
+      return std::tan(M_PI * (p - 0.5));
+    }
+    if (dof == 2) {
+      return (2 * p - 1) * std::sqrt(2.0 / (4 * p * (1 - p)));
+    }
+    // Cornish-Fisher expansion around the normal quantile, accurate to
+    // about 1e-3 from 3 degrees of freedom on.
+    double z = NormalQuantile(p);
+    double z3 = z * z * z, z5 = z3 * z * z, z7 = z5 * z * z;
+    double v = dof;
+    return z + (z3 + z) / (4 * v)
+             + (5 * z5 + 16 * z3 + 3 * z) / (96 * v * v)
+             + (3 * z7 + 19 * z5 + 17 * z3 - 15 * z) / (384 * v * v * v);
+  }
+
+private:
+  uint32_t m_n;
+  double m_mean;
+  double m_m2;
+};
+
+// ==================== REPLICATION RUNNER ====================
+// Runs independent replications of a scenario, one RngSeedManager run number
+// each, and stops as soon as the confidence interval of every KPI is narrower
+// than RelativeWidth (relative to its mean).
+//
+// The ns-3 simulator is a process-wide singleton, so replications run in
+// forked worker processes; each worker reports its KPI vector back through a
+// pipe. Results are folded into the statistics in run-number order, never in
+// completion order, so fast (and possibly atypical) replications cannot bias
+// the stopping decision and a given seed always stops at the same count.
+class ReplicationRunner {
+public:
+  typedef std::function<std::vector<double> (uint32_t run)> Scenario;
+
+  explicit ReplicationRunner(const std::vector<std::string> &kpiNames)
+    : m_kpiNames(kpiNames),
+      m_kpis(kpiNames.size()),
+      m_seed(1),
+      m_firstRun(1),
+      m_minReplications(5),
+      m_maxReplications(200),
+      m_parallel(std::max(1u, std::thread::hardware_concurrency())),
+      m_relativeWidth(0.05),
+      m_confidence(0.95) {}
+
+  void AddValues(CommandLine &cmd) {
+    cmd.AddValue("seed", "RngSeedManager seed shared by all replications", m_seed);
+    cmd.AddValue("run", "Run number of the first replication", m_firstRun);
+    cmd.AddValue("minReplications", "Replications before convergence is checked", m_minReplications);
+    cmd.AddValue("maxReplications", "Hard cap on replications", m_maxReplications);
+    cmd.AddValue("parallel", "Replications running at the same time", m_parallel);
+    cmd.AddValue("relativeWidth", "Target CI width relative to the KPI mean", m_relativeWidth);
+    cmd.AddValue("confidence", "Confidence level of the KPI intervals", m_confidence);
+  }
+
+  uint32_t GetSeed() const { return m_seed; }
+  uint32_t GetFirstRun() const { return m_firstRun; }
+
+  bool HasConverged() const {
+    if (m_kpis.empty() || m_kpis[0].GetN() < std::max(2u, m_minReplications)) {
+      return false;
+    }
+    for (const KpiAccumulator &kpi : m_kpis) {
+      if (!(kpi.GetRelativeWidth(m_confidence) <= m_relativeWidth)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns the number of replications folded into the statistics.
+  uint32_t Run(Scenario scenario) {
+    std::map<pid_t, std::pair<uint32_t, int>> workers;  // pid -> (run, pipe fd)
+    std::map<uint32_t, std::vector<double>> finished;   // out-of-order results
+    uint32_t nextRun = m_firstRun;
+    uint32_t nextCommit = m_firstRun;
+    uint32_t lastRun = m_firstRun + m_maxReplications;
+
+    while (!HasConverged() && nextCommit < lastRun) {
+      while (workers.size() < std::max(1u, m_parallel) && nextRun < lastRun) {
+        Spawn(scenario, nextRun++, workers);
+      }
+
+      int status;
+      pid_t pid = waitpid(-1, &status, 0);
+      if (pid < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        NS_FATAL_ERROR("waitpid failed while collecting replications");
+      }
+      auto it = workers.find(pid);
+      if (it == workers.end()) {
+        continue;
+      }
+      uint32_t run = it->second.first;
+      std::vector<double> kpis(m_kpiNames.size());
+      ssize_t expected = kpis.size() * sizeof(double);
+      ssize_t got = read(it->second.second, kpis.data(), expected);
+      close(it->second.second);
+      workers.erase(it);
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || got != expected) {
+        NS_FATAL_ERROR("Replication with run " << run << " failed");
+      }
+      finished[run] = kpis;
+
+      while (!finished.empty() && finished.begin()->first == nextCommit && !HasConverged()) {
+        for (uint32_t k = 0; k < m_kpis.size(); ++k) {
+          m_kpis[k].Add(finished.begin()->second[k]);
+        }
+        finished.erase(finished.begin());
+        nextCommit++;
+      }
+    }
+
+    // Replications still in flight are not needed any more.
+    for (auto &worker : workers) {
+      kill(worker.first, SIGKILL);
+      waitpid(worker.first, nullptr, 0);
+      close(worker.second.second);
+    }
+    return nextCommit - m_firstRun;
+  }
+
+  void Print(std::ostream &os) const {
+    os << "\n=== Replication Results (seed " << m_seed << ", "
+       << m_kpis[0].GetN() << " replications, "
+       << (HasConverged() ? "converged" : "NOT converged") << ") ===\n";
+    for (uint32_t k = 0; k < m_kpis.size(); ++k) {
+      const KpiAccumulator &kpi = m_kpis[k];
+      os << std::setw(24) << std::left << m_kpiNames[k]
+         << " mean " << kpi.GetMean()
+         << " +/- " << kpi.GetHalfWidth(m_confidence)
+         << " (" << m_confidence * 100 << "% CI, relative width "
+         << kpi.GetRelativeWidth(m_confidence) << ")\n";
+    }
+  }
+
+private:
+  void Spawn(Scenario &scenario, uint32_t run,
+             std::map<pid_t, std::pair<uint32_t, int>> &workers) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      NS_FATAL_ERROR("Could not create replication pipe");
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+      NS_FATAL_ERROR("Could not fork replication worker");
+    }
+    if (pid == 0) {
+      close(fds[0]);
+      RngSeedManager::SetSeed(m_seed);
+      RngSeedManager::SetRun(run);
+      std::vector<double> kpis = scenario(run);
+      kpis.resize(m_kpiNames.size(), std::numeric_limits<double>::quiet_NaN());
+      ssize_t size = kpis.size() * sizeof(double);
+      bool ok = write(fds[1], kpis.data(), size) == size;
+      close(fds[1]);
+      std::cout.flush();
+      _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    workers[pid] = std::make_pair(run, fds[0]);
+  }
+
+  std::vector<std::string> m_kpiNames;
+  std::vector<KpiAccumulator> m_kpis;
+  uint32_t m_seed;
+  uint32_t m_firstRun;
+  uint32_t m_minReplications;
+  uint32_t m_maxReplications;
+  uint32_t m_parallel;
+  double m_relativeWidth;
+  double m_confidence;
+};
+
+} // namespace ns3
+
+#endif /* REPLICATION_RUNNER_H */
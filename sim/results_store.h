@@ -0,0 +1,203 @@
+#ifndef RESULTS_STORE_H
+#define RESULTS_STORE_H
+
+#include "ns3/core-module.h"
+
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== RESULTS STORE ====================
+// Shared SQLite results database for every scenario. Each run is keyed by
+// (scenario, params, seed, run); its time series and KPIs are buffered in
+// memory and written in large transactions through prepared statements, so a
+// sample costs a vector push during the simulation rather than a file write.
+//
+// The database runs in WAL mode, so parallel replications (one process each)
+// can append to the same file while earlier sweeps are being queried, e.g.
+//
+//   SELECT r.params, k.value FROM kpis k JOIN runs r ON r.id = k.run_id
+//   WHERE r.scenario = 'wifi' AND k.name = 'delay_ms';
+//
+// Re-running an existing key replaces its previous rows.
+class ResultsStore {
+public:
+  ResultsStore(const std::string &path, const std::string &scenario,
+               const std::string &params, uint32_t seed, uint64_t run,
+               size_t batchSize = 50000)
+    : m_db(nullptr), m_insertSample(nullptr), m_insertKpi(nullptr),
+      m_runId(0), m_batchSize(batchSize) {
+    if (sqlite3_open(path.c_str(), &m_db) != SQLITE_OK) {
+      NS_FATAL_ERROR("Cannot open results database " << path << ": " << sqlite3_errmsg(m_db));
+    }
+    sqlite3_busy_timeout(m_db, 60000);
+    Exec("PRAGMA journal_mode=WAL");
+    Exec("PRAGMA synchronous=NORMAL");
+    Exec("CREATE TABLE IF NOT EXISTS runs ("
+         "id INTEGER PRIMARY KEY, scenario TEXT NOT NULL, params TEXT NOT NULL, "
+         "seed INTEGER NOT NULL, run INTEGER NOT NULL, "
+         "created TEXT DEFAULT CURRENT_TIMESTAMP, "
+         "UNIQUE (scenario, params, seed, run))");
+    Exec("CREATE TABLE IF NOT EXISTS series ("
+         "id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE)");
+    Exec("CREATE TABLE IF NOT EXISTS samples ("
+         "run_id INTEGER NOT NULL, series_id INTEGER NOT NULL, node INTEGER NOT NULL, "
+         "time REAL NOT NULL, value REAL NOT NULL)");
+    Exec("CREATE INDEX IF NOT EXISTS samples_run_series ON samples (run_id, series_id, node, time)");
+    Exec("CREATE TABLE IF NOT EXISTS kpis ("
+         "run_id INTEGER NOT NULL, name TEXT NOT NULL, value REAL, "
+         "PRIMARY KEY (run_id, name)) WITHOUT ROWID");
+
+    Exec("BEGIN IMMEDIATE");
+    sqlite3_stmt *stmt = Prepare("INSERT OR IGNORE INTO runs (scenario, params, seed, run) VALUES (?, ?, ?, ?)");
+    sqlite3_bind_text(stmt, 1, scenario.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, params.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, seed);
+    sqlite3_bind_int64(stmt, 4, run);
+    Step(stmt);
+    sqlite3_finalize(stmt);
+
+    stmt = Prepare("SELECT id FROM runs WHERE scenario = ? AND params = ? AND seed = ? AND run = ?");
+    sqlite3_bind_text(stmt, 1, scenario.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, params.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, seed);
+    sqlite3_bind_int64(stmt, 4, run);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+      NS_FATAL_ERROR("Cannot resolve results run id: " << sqlite3_errmsg(m_db));
+    }
+    m_runId = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+
+    std::ostringstream clear;
+    clear << "DELETE FROM samples WHERE run_id = " << m_runId << "; "
+          << "DELETE FROM kpis WHERE run_id = " << m_runId;
+    Exec(clear.str());
+    Exec("COMMIT");
+
+    m_insertSample = Prepare("INSERT INTO samples (run_id, series_id, node, time, value) VALUES (?, ?, ?, ?, ?)");
+    m_insertKpi = Prepare("INSERT OR REPLACE INTO kpis (run_id, name, value) VALUES (?, ?, ?)");
+    m_samples.reserve(m_batchSize);
+  }
+
+  ~ResultsStore() {
+    Flush();
+    sqlite3_finalize(m_insertSample);
+    sqlite3_finalize(m_insertKpi);
+    sqlite3_close(m_db);
+  }
+
+  ResultsStore(const ResultsStore &) = delete;
+  ResultsStore &operator=(const ResultsStore &) = delete;
+
+  // Time-series point; `node` distinguishes per-device series.
+  void AddSample(const std::string &series, double time, double value, uint32_t node = 0) {
+    m_samples.push_back(Sample{GetSeriesId(series), node, time, value});
+    if (m_samples.size() >= m_batchSize) {
+      Flush();
+    }
+  }
+
+  void AddKpi(const std::string &name, double value) {
+    m_kpis.push_back(std::make_pair(name, value));
+  }
+
+  // Writes everything buffered so far in a single transaction.
+  void Flush() {
+    if (m_samples.empty() && m_kpis.empty()) {
+      return;
+    }
+    Exec("BEGIN IMMEDIATE");
+    for (const Sample &s : m_samples) {
+      sqlite3_bind_int64(m_insertSample, 1, m_runId);
+      sqlite3_bind_int64(m_insertSample, 2, s.series);
+      sqlite3_bind_int64(m_insertSample, 3, s.node);
+      sqlite3_bind_double(m_insertSample, 4, s.time);
+      sqlite3_bind_double(m_insertSample, 5, s.value);
+      Step(m_insertSample);
+      sqlite3_reset(m_insertSample);
+    }
+    for (const auto &kpi : m_kpis) {
+      sqlite3_bind_int64(m_insertKpi, 1, m_runId);
+      sqlite3_bind_text(m_insertKpi, 2, kpi.first.c_str(), -1, SQLITE_STATIC);
+      sqlite3_bind_double(m_insertKpi, 3, kpi.second);
+      Step(m_insertKpi);
+      sqlite3_reset(m_insertKpi);
+    }
+    Exec("COMMIT");
+    m_samples.clear();
+    m_kpis.clear();
+  }
+
+  int64_t GetRunId() const { return m_runId; }
+
+private:
+  struct Sample {
+    int64_t series;
+    uint32_t node;
+    double time;
+    double value;
+  };
+
+  int64_t GetSeriesId(const std::string &name) {
+    auto it = m_seriesIds.find(name);
+    if (it != m_seriesIds.end()) {
+      return it->second;
+    }
+    sqlite3_stmt *stmt = Prepare("INSERT OR IGNORE INTO series (name) VALUES (?)");
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+    Step(stmt);
+    sqlite3_finalize(stmt);
+    stmt = Prepare("SELECT id FROM series WHERE name = ?");
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+      NS_FATAL_ERROR("Cannot resolve series id for " << name << ": " << sqlite3_errmsg(m_db));
+    }
+    int64_t id = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    m_seriesIds[name] = id;
+    return id;
+  }
+
+  void Exec(const std::string &sql) {
+    char *error = nullptr;
+    if (sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+      std::string message = error != nullptr ? error : "unknown error";
+      sqlite3_free(error);
+      NS_FATAL_ERROR("Results database error on \"" << sql << "\": " << message);
+    }
+  }
+
+  sqlite3_stmt *Prepare(const std::string &sql) {
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+      NS_FATAL_ERROR("Cannot prepare \"" << sql << "\": " << sqlite3_errmsg(m_db));
+    }
+    return stmt;
+  }
+
+  void Step(sqlite3_stmt *stmt) {
+    int rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+      NS_FATAL_ERROR("Results database write failed: " << sqlite3_errmsg(m_db));
+    }
+  }
+
+  sqlite3 *m_db;
+  sqlite3_stmt *m_insertSample;
+  sqlite3_stmt *m_insertKpi;
+  int64_t m_runId;
+  size_t m_batchSize;
+  std::vector<Sample> m_samples;
+  std::vector<std::pair<std::string, double>> m_kpis;
+  std::unordered_map<std::string, int64_t> m_seriesIds;
+};
+
+} // namespace ns3
+
+#endif /* RESULTS_STORE_H */
@@ -0,0 +1,219 @@
+#ifndef SCENARIO_BUILDER_H
+#define SCENARIO_BUILDER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/energy-module.h"
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== ATTRIBUTE AND TRACE HANDLES ====================
+// Helpers set attributes by name on every object they create: a TypeId
+// search by string, a fresh checker pass and a value copy per object, per
+// attribute. A handle does the lookup and the check once and then writes
+// straight through the accessor, which is all that is left per object.
+class AttributeHandle {
+public:
+  AttributeHandle(TypeId tid, const std::string &name, const AttributeValue &value) {
+    TypeId::AttributeInformation info;
+    if (!tid.LookupAttributeByName(name, &info)) {
+      NS_FATAL_ERROR("No attribute " << name << " in " << tid.GetName());
+    }
+    m_value = info.checker->CreateValidValue(value);
+    if (m_value == nullptr) {
+      NS_FATAL_ERROR("Invalid value for " << tid.GetName() << "::" << name);
+    }
+    m_accessor = info.accessor;
+  }
+
+  template <typename T>
+  void Apply(Ptr<T> object) const {
+    m_accessor->Set(PeekPointer(object), *m_value);
+  }
+
+private:
+  Ptr<const AttributeAccessor> m_accessor;
+  Ptr<AttributeValue> m_value;
+};
+
+// Same for trace sources: connecting through the resolved accessor skips the
+// by-name lookup, and unlike a Config path it never walks the node list.
+//
+// A missing trace source is fatal unless the handle is built with
+// required=false, for sources a third-party module may not have under that
+// name: then it warns once and Connect() does nothing and returns false. A
+// callback whose signature does not match the source still aborts inside
+// ns-3's Callback::Assign either way; there is no non-fatal way to check it.
+class TraceHandle {
+public:
+  TraceHandle(TypeId tid, const std::string &name, bool required = true)
+    : m_accessor(tid.LookupTraceSourceByName(name)),
+      m_name(tid.GetName() + "::" + name),
+      m_required(required),
+      m_warned(false) {
+    if (m_accessor == nullptr) {
+      Fail("No trace source " + m_name);
+    }
+  }
+
+  bool IsValid() const { return m_accessor != nullptr; }
+
+  // Returns whether the callback was connected.
+  template <typename T>
+  bool Connect(Ptr<T> object, const CallbackBase &callback) const {
+    if (m_accessor == nullptr) {
+      return false;
+    }
+    if (!m_accessor->ConnectWithoutContext(PeekPointer(object), callback)) {
+      Fail("Could not connect " + m_name + " on " + object->GetInstanceTypeId().GetName());
+      return false;
+    }
+    return true;
+  }
+
+private:
+  void Fail(const std::string &message) const {
+    if (m_required) {
+      NS_FATAL_ERROR(message);
+    }
+    if (!m_warned) {
+      NS_LOG_UNCOND("Warning: " << message);
+      m_warned = true;
+    }
+  }
+
+  Ptr<const TraceSourceAccessor> m_accessor;
+  std::string m_name;
+  bool m_required;
+  mutable bool m_warned;
+};
+
+// ==================== BULK INSTALLS ====================
+// What MobilityHelper does for constant positions, minus the per-node
+// ObjectFactory and attribute pass: one model per node at positions[i].
+inline void InstallConstantPositions(const NodeContainer &nodes, const std::vector<Vector> &positions) {
+  NS_ASSERT(positions.size() >= nodes.GetN());
+  for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+    Ptr<ConstantPositionMobilityModel> model = CreateObject<ConstantPositionMobilityModel>();
+    model->SetPosition(positions[i]);
+    nodes.Get(i)->AggregateObject(model);
+  }
+}
+
+inline void InstallConstantPositions(const NodeContainer &nodes, Ptr<PositionAllocator> allocator) {
+  std::vector<Vector> positions;
+  positions.reserve(nodes.GetN());
+  for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+    positions.push_back(allocator->GetNext());
+  }
+  InstallConstantPositions(nodes, positions);
+}
+
+// EnergySourceHelper::Install for a source of type T, with its attributes
+// resolved once by the caller. Like the helpers, it also aggregates an
+// EnergySourceContainer to each node so device energy model helpers find
+// the source.
+template <typename T>
+EnergySourceContainer InstallEnergySources(const NodeContainer &nodes,
+                                           const std::vector<AttributeHandle> &attributes) {
+  EnergySourceContainer sources;
+  for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+    Ptr<Node> node = nodes.Get(i);
+    Ptr<T> source = CreateObject<T>();
+    for (const AttributeHandle &attribute : attributes) {
+      attribute.Apply(source);
+    }
+    source->SetNode(node);
+    sources.Add(source);
+    Ptr<EnergySourceContainer> onNode = node->GetObject<EnergySourceContainer>();
+    if (onNode == nullptr) {
+      onNode = CreateObject<EnergySourceContainer>();
+      node->AggregateObject(onNode);
+    }
+    onNode->Add(source);
+  }
+  return sources;
+}
+
+// BasicEnergySourceHelper::Install; a zero updateInterval keeps the
+// source's default PeriodicEnergyUpdateInterval.
+inline EnergySourceContainer InstallBasicEnergySources(const NodeContainer &nodes, double initialEnergyJ,
+                                                       double supplyVoltageV = 3.0,
+                                                       Time updateInterval = Time()) {
+  TypeId tid = BasicEnergySource::GetTypeId();
+  std::vector<AttributeHandle> attributes;
+  attributes.emplace_back(tid, "BasicEnergySourceInitialEnergyJ", DoubleValue(initialEnergyJ));
+  attributes.emplace_back(tid, "BasicEnergySupplyVoltageV", DoubleValue(supplyVoltageV));
+  if (!updateInterval.IsZero()) {
+    attributes.emplace_back(tid, "PeriodicEnergyUpdateInterval", TimeValue(updateInterval));
+  }
+  return InstallEnergySources<BasicEnergySource>(nodes, attributes);
+}
+
+// ==================== SETUP TIMING ====================
+// Wall time per setup phase: Phase() closes the running phase and opens the
+// next, Stop() closes the last one.
+class SetupTimer {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  SetupTimer() : m_running(false) {}
+
+  void Phase(const std::string &name) {
+    Stop();
+    m_phases.push_back(std::make_pair(name, 0.0));
+    m_start = Clock::now();
+    m_running = true;
+  }
+
+  void Stop() {
+    if (m_running) {
+      m_phases.back().second = std::chrono::duration<double, std::milli>(Clock::now() - m_start).count();
+      m_running = false;
+    }
+  }
+
+  const std::vector<std::pair<std::string, double>> &GetPhases() const { return m_phases; }
+
+  // Milliseconds in `name`, 0 if there was no such phase.
+  double GetMs(const std::string &name) const {
+    for (const auto &phase : m_phases) {
+      if (phase.first == name) {
+        return phase.second;
+      }
+    }
+    return 0.0;
+  }
+
+  double GetTotalMs() const {
+    double total = 0;
+    for (const auto &phase : m_phases) {
+      total += phase.second;
+    }
+    return total;
+  }
+
+  void Print(std::ostream &os) const {
+    os << "Setup:";
+    for (const auto &phase : m_phases) {
+      os << " " << phase.first << " " << phase.second << " ms,";
+    }
+    os << " total " << GetTotalMs() << " ms\n";
+  }
+
+private:
+  std::vector<std::pair<std::string, double>> m_phases;
+  Clock::time_point m_start;
+  bool m_running;
+};
+
+} // namespace ns3
+
+#endif /* SCENARIO_BUILDER_H */
@@ -41,7 +41,6 @@
 #include "ns3/energy-module.h"
 #include "ns3/sigfox-net-device.h"
 #include "ns3/sigfox-radio-energy-model-helper.h"
-#include "ns3/sdc-energy-source-helper.h"
 #include "ns3/sdc-energy-source.h"
 #include <algorithm>
 #include <ctime>
@@ -50,6 +49,17 @@
 #include <ctime>
 #include <fstream>
 #include <iostream>
+#include "energy_ledger.h"
+#include "results_store.h"
+#include "event_profiler.h"
+#include "fix_integrity.h"
+#include "culled_sigfox_channel.h"
+#include "cell_deployment.h"
+#include "frame_dedup.h"
+#include "scenario_builder.h"
+#include <chrono>
+#include <memory>
+#include <unordered_map>
 
 using namespace ns3;
 using namespace sigfox;
@@ -67,10 +77,53 @@ uint32_t numberofmeasurments = 0;
 
 int appPeriodSeconds = TotalTime;
 double battery = 10000 * 60 * 60;  // 10000mAh   ..... converted into mAs
-double EnergyConsumptionMeasurment = 0;
-//double EnergyConsumptionSelfDischarge =0;
-double EnergyConsumptionNode = 0;
-double TotalRemainingEnergy = 0;
+double measureCharge = 6.58*4.9;   // Measure current * measure time
+double selfDischargeRate = 0.02;   // Fraction of the remaining charge lost...
+double selfDischargeWindow = 30 * day;  // ...over this many seconds
+EnergyLedger ledger;               // Per-device battery, measurement and self-discharge state
+std::string resultsDb = "logs/results.db";
+std::unique_ptr<ResultsStore> results;
+bool profile = false;               // Event loop profile after the run
+uint32_t profileTop = 20;
+bool integrity = false;             // Seal buffered fixes once per sync batch
+double syncPeriod = 600;            // Seconds between sync batches
+SealCostModel sealCost = {40, 2000, 32e6, 3.2};  // Cortex-M0+ class MCU; current in mA like battery
+std::vector<FixBatchSealer> sealers;
+std::vector<Ptr<MobilityModel>> deviceMobility;
+std::unique_ptr<BatchVerifier> verifier;
+std::vector<SealedBatch> syncBatches;
+uint64_t sealedBatches = 0;
+double sealHostSeconds = 0;         // Host time spent sealing, for reference
+double verifyHostSeconds = 0;       // Host time spent in the ingest-side verifier
+bool rangeCulling = false;          // Only deliver to PHYs within useful range
+uint32_t interferenceIndex = 0;     // Gateway interference lookups (see interference_index.h)
+uint32_t gatewayReceived = 0;       // Gateway PHY outcomes, summed over gateways
+uint32_t gatewayInterfered = 0;
+std::string gatewaySites = "scratch/enb_sites.txt";  // Gateway layout when nGateways > 1
+double dedupWindow = 10;            // Seconds the network server waits for other gateways' copies
+std::unique_ptr<DuplicateFilter> dedup;
+std::vector<uint32_t> frameSequence;  // Next sequence number per device
+// Packet uid -> (device, sequence number), current and previous window. The
+// channel hands every gateway a copy with the sender's uid, standing in for
+// the device id and sequence number a real frame carries. A frame's three
+// repetitions are the same packet or Packet::Copy()s of it, which keep the
+// uid, so they are numbered once and any of them reaching a gateway counts
+// as that frame; phyTransmissions / framesSent shows what the module did
+// (about 3 when repetitions share the uid, 1 if each got a fresh packet, in
+// which case every repetition is counted as a frame of its own).
+std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> sentFrames[2];
+uint64_t framesSent = 0;
+uint64_t phyTransmissions = 0;
+// What the gateways forwarded, in arrival order. Replayed through a fresh
+// filter at the end to time deduplication as one batch.
+struct ForwardedFrame
+{
+  uint32_t device;
+  uint32_t sequence;
+  uint16_t gateway;
+  int64_t time;
+};
+std::vector<ForwardedFrame> forwarded;
 int SelectStrategy = 1;       //  Transmission Strategy used for case study
                                     //      1 for Greedy Strategy
                                     //      2 for Optimise Listening Strategy
@@ -78,20 +131,27 @@ int SelectStrategy = 1;       //  Transmission Strategy used for case study
                                     //      4 for Data compression Strategy
 //The node send a bidirectional UL after BDPF number of unidirectional ULs
 int BDPF= 1; // SelectBiDirectionalProcedureFrequency
+uint32_t seed = 1;                  // RngSeedManager seed and run number
+uint32_t run = 1;
  
 //______________________Print Data________________________________
 void
 Print (void)
 {
-  if (TotalRemainingEnergy >= 0)
-    TotalRemainingEnergy = battery - EnergyConsumptionNode - EnergyConsumptionMeasurment;
-  if (TotalRemainingEnergy <= 0)
-    TotalRemainingEnergy = 0;
-  NS_LOG_UNCOND ( battery<<"    "<<TotalRemainingEnergy << "   " <<EnergyConsumptionNode <<  "   " << EnergyConsumptionMeasurment);
+  ledger.Refresh ();
+  NS_LOG_UNCOND ( battery<<"    "<<ledger.GetRemaining (0) << "   " <<ledger.GetRadioEnergy (0) <<  "   " << ledger.GetMeasurementEnergy (0));
+  if (ledger.GetN () > 1)
+    NS_LOG_UNCOND ("Fleet of " << ledger.GetN () << ": mean remaining " << ledger.GetMeanRemaining ()
+      << ", min " << ledger.GetMinRemaining () << ", depleted " << ledger.CountDepleted ());
   std::ofstream out ("BatteryLevel.txt", std::ios::app);
-  out << (Simulator::Now ()).GetSeconds () << " , " << TotalRemainingEnergy << "" << std::endl;
+  out << (Simulator::Now ()).GetSeconds () << " , " << ledger.GetRemaining (0) << "" << std::endl;
   out.close ();
-  Simulator::Schedule (Seconds (60.0), &Print);
+  if (results)
+    {
+      results->AddSample ("battery_remaining", Simulator::Now ().GetSeconds (), ledger.GetRemaining (0));
+      results->AddSample ("fleet_mean_remaining", Simulator::Now ().GetSeconds (), ledger.GetMeanRemaining ());
+    }
+  ScheduleLabelled ("Print", Seconds (60.0), &Print);
 }
 
 void
@@ -101,6 +161,11 @@ syscurrent (double y, double x)
   out << (Simulator::Now ()).GetSeconds () << " " << y << std::endl;
   out << (Simulator::Now ()).GetSeconds () << " " << x << std::endl;
   out.close ();
+  if (results)
+    {
+      results->AddSample ("system_current", Simulator::Now ().GetSeconds (), y);
+      results->AddSample ("system_current", Simulator::Now ().GetSeconds (), x);
+    }
 }
 
 //________________________________________________________________
@@ -112,47 +177,149 @@ RemainingEnergy (double oldValue, double remainingEnergy)
     << "s Current remaining energy = " << remainingEnergy << "J");
 }
 
-/// Trace function for total energy consumption at node.
+/// Trace function for total energy consumption at each device's radio.
 void
-TotalEnergy (double oldValue, double totalEnergy)
+TotalEnergy (uint32_t device, double oldValue, double totalEnergy)
 {
-  NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "s Total energy consumed by radio = " << totalEnergy << "J");
-  EnergyConsumptionNode = totalEnergy;
+  if (device == 0)
+    NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "s Total energy consumed by radio = " << totalEnergy << "J");
+  ledger.SetRadioEnergy (device, totalEnergy);
 }
 //______________________Measuring value___________________________
+// One event per period charges the measurement to the whole fleet.
 void
 Measure ()
 {
-  NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "Node 0 Measures a Value");
-  NS_LOG_UNCOND ("Old value"<<EnergyConsumptionMeasurment<<"Simulation time"<<Simulator::Now ().GetSeconds () );
-  EnergyConsumptionMeasurment += 6.58*4.9;// Measure current * measure time
-  //numberofmeasurments += 1;
-   /* Ptr<Packet> packet;
-    packet = Create<Packet> (12);
-    m_mac->Send (packet);*/
-    //appHelper.SendPacket();
-  Simulator::Schedule (Seconds (60.0), &Measure);
-  NS_LOG_UNCOND ("new value"<<EnergyConsumptionMeasurment<<"Simulation time"<<Simulator::Now ().GetSeconds () );
+  NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << " " << ledger.GetN () << " nodes measure a value");
+  NS_LOG_UNCOND ("Old value"<<ledger.GetMeasurementEnergy (0)<<"Simulation time"<<Simulator::Now ().GetSeconds () );
+  ledger.ApplyMeasurement (measureCharge);
+  if (integrity)
+    {
+      int64_t nowMs = Simulator::Now ().GetMilliSeconds ();
+      for (uint32_t i = 0; i < sealers.size (); ++i)
+        {
+          Vector pos = deviceMobility[i]->GetPosition ();
+          sealers[i].Record (nowMs, std::lround (pos.x * 100), std::lround (pos.y * 100));
+        }
+    }
+  ScheduleLabelled ("Measure", Seconds (60.0), &Measure);
+  NS_LOG_UNCOND ("new value"<<ledger.GetMeasurementEnergy (0)<<"Simulation time"<<Simulator::Now ().GetSeconds () );
+}
+//______________________Sealing sync batches______________________
+// Every device seals what it buffered since the last sync (one MAC per
+// batch), pays for it in MCU time, and the ingest side verifies the whole
+// round in one batched call.
+void
+SyncBatches ()
+{
+  auto start = std::chrono::steady_clock::now ();
+  syncBatches.clear ();
+  for (FixBatchSealer &sealer : sealers)
+    {
+      syncBatches.push_back (sealer.Seal ());
+    }
+  auto sealed = std::chrono::steady_clock::now ();
+  // Every device buffered the same fixes, so every seal costs the same
+  if (!syncBatches.empty ())
+    ledger.ApplyCompute (sealCost.Charge (syncBatches[0].payload.size ()));
+  std::size_t rejected = verifier->Verify (syncBatches);
+  auto verified = std::chrono::steady_clock::now ();
+
+  sealedBatches += syncBatches.size ();
+  sealHostSeconds += std::chrono::duration<double> (sealed - start).count ();
+  verifyHostSeconds += std::chrono::duration<double> (verified - sealed).count ();
+  if (rejected > 0)
+    NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "s " << rejected << " sync batches failed verification");
+  ScheduleLabelled ("SyncBatches", Seconds (syncPeriod), &SyncBatches);
+}
+//______________________Network server__________________________
+void
+FrameSent (uint32_t device, Ptr<const Packet> packet, uint32_t systemId)
+{
+  phyTransmissions++;
+  uint64_t uid = packet->GetUid ();
+  if (sentFrames[0].count (uid) || sentFrames[1].count (uid))
+    return;  // Repetition of a frame already numbered
+  sentFrames[0][uid] = std::make_pair (device, frameSequence[device]++);
+  framesSent++;
+}
+
+// Every gateway forwards what it decodes; the server keeps the first copy.
+void
+GatewayReceived (uint16_t gateway, Ptr<const Packet> packet, uint32_t systemId)
+{
+  gatewayReceived++;
+  uint64_t uid = packet->GetUid ();
+  auto frame = sentFrames[0].find (uid);
+  if (frame == sentFrames[0].end ())
+    {
+      frame = sentFrames[1].find (uid);
+      if (frame == sentFrames[1].end ())
+        return;
+    }
+  ForwardedFrame f = {frame->second.first, frame->second.second, gateway,
+                      Simulator::Now ().GetTimeStep ()};
+  dedup->Receive (f.device, f.sequence, f.gateway, f.time);
+  forwarded.push_back (f);
+}
+
+void
+GatewayInterfered (Ptr<const Packet> packet, uint32_t systemId)
+{
+  gatewayInterfered++;
+}
+
+void
+RotateSentFrames ()
+{
+  sentFrames[1].swap (sentFrames[0]);
+  sentFrames[0].clear ();
+  ScheduleLabelled ("RotateSentFrames", Seconds (dedupWindow), &RotateSentFrames);
 }
 //______________________Measuring value___________________________
 void
 SelfDischarge ()
 {
-  NS_LOG_UNCOND ("Old value" << TotalRemainingEnergy << "Simulation time"
+  NS_LOG_UNCOND ("Old value" << ledger.GetRemaining (0) << "Simulation time"
     << Simulator::Now ().GetSeconds ());
-  TotalRemainingEnergy =
-      TotalRemainingEnergy -
-      0.02 * (TotalRemainingEnergy / (30 * day)) *
-          day; //EnergyConsumptionSelfDischarge += 5.4;     // battery[id]=battery[id]−sdc_rate[id]∗(battery[id]/sdc_time[id])∗1∗day
-  Simulator::Schedule (Seconds (86400.0), &SelfDischarge);
+  // battery[id]=battery[id]−sdc_rate[id]∗(battery[id]/sdc_time[id])∗1∗day
+  ledger.ApplySelfDischarge (selfDischargeRate, selfDischargeWindow, day);
+  ScheduleLabelled ("SelfDischarge", Seconds (86400.0), &SelfDischarge);
+}
+//______________________Energy models_____________________________
+// SigfoxRadioEnergyModelHelper::Install with the model and TX current
+// attributes resolved once. The wiring is the helper's DoInstall, which
+// Dockerfile.Sigfox checks still makes these calls.
+DeviceEnergyModelContainer
+InstallSigfoxRadioEnergyModels (const NetDeviceContainer &devices, const EnergySourceContainer &sources,
+                                const std::vector<AttributeHandle> &modelAttributes,
+                                const AttributeHandle &txCurrent)
+{
+  NS_ASSERT (devices.GetN () <= sources.GetN ());
+  DeviceEnergyModelContainer models;
+  for (uint32_t i = 0; i < devices.GetN (); ++i)
+    {
+      Ptr<SigfoxNetDevice> device = DynamicCast<SigfoxNetDevice> (devices.Get (i));
+      Ptr<EnergySource> source = sources.Get (i);
+      NS_ASSERT (device->GetNode () == source->GetNode ());
+      Ptr<SigfoxRadioEnergyModel> model = CreateObject<SigfoxRadioEnergyModel> ();
+      for (const AttributeHandle &attribute : modelAttributes)
+        attribute.Apply (model);
+      model->SetEnergySource (source);
+      source->AppendDeviceEnergyModel (model);
+      source->SetNode (device->GetNode ());
+      DynamicCast<EndPointSigfoxPhy> (device->GetPhy ())->RegisterListener (model->GetPhyListener ());
+      Ptr<ConstantSigfoxTxCurrentModel> current = CreateObject<ConstantSigfoxTxCurrentModel> ();
+      txCurrent.Apply (current);
+      model->SetTxCurrentModel (current);
+      models.Add (model);
+    }
+  return models;
 }
 
 int
 main (int argc, char *argv[])
 {
-    srand(100);
-    
-    
     // LogComponentEnable("PeriodicSender", LOG_LEVEL_ALL);
     LogComponentEnable ("SigfoxEnergyModelExample", LOG_LEVEL_ALL);
     // LogComponentEnable("LoraChannel", LOG_LEVEL_INFO);
@@ -187,11 +354,60 @@ main (int argc, char *argv[])
     LogComponentEnableAll (LOG_PREFIX_FUNC);
     LogComponentEnableAll (LOG_PREFIX_NODE);
     LogComponentEnableAll (LOG_PREFIX_TIME);
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("nDevices", "Number of end devices", nDevices);
+  cmd.AddValue ("seed", "RngSeedManager seed", seed);
+  cmd.AddValue ("run", "RngSeedManager run number", run);
+  cmd.AddValue ("nGateways", "Number of gateways (more than 1 places them from gatewaySites)", nGateways);
+  cmd.AddValue ("gatewaySites", "Gateway site file (x y [z [name]] in the SUMO projection)", gatewaySites);
+  cmd.AddValue ("dedupWindow", "Seconds the network server keeps a frame for duplicate elimination", dedupWindow);
+  cmd.AddValue ("simulationTime", "Simulated time in seconds", simulationTime);
+  cmd.AddValue ("resultsDb", "SQLite results database, relative to the ns-3 root (empty to disable)", resultsDb);
+  cmd.AddValue ("integrity", "Seal buffered fixes with a hash chain once per sync batch", integrity);
+  cmd.AddValue ("syncPeriod", "Seconds between sync batches", syncPeriod);
+  cmd.AddValue ("sealCyclesPerByte", "Device MCU cycles per byte sealed", sealCost.cyclesPerByte);
+  cmd.AddValue ("mcuClockHz", "Device MCU clock", sealCost.clockHz);
+  cmd.AddValue ("mcuCurrent", "Device MCU run current (mA)", sealCost.activeCurrent);
+  cmd.AddValue ("profile", "Print a wall-time profile of the event loop", profile);
+  cmd.AddValue ("profileTop", "Event types and nodes listed in the profile", profileTop);
+  cmd.AddValue ("rangeCulling", "Skip receivers beyond useful range on the channel", rangeCulling);
+  cmd.AddValue ("interferenceIndex", "Gateway interference lookups: 0 = flat list, 1 = InterferenceIndex, "
+                "2 = index checked against the flat list", interferenceIndex);
+  cmd.Parse (argc, argv);
+  RngSeedManager::SetSeed (seed);
+  RngSeedManager::SetRun (run);
+  GlobalValue::Bind ("InterferenceIndex", UintegerValue (interferenceIndex));
+
+  if (profile)
+    {
+      EnableEventProfiler ();
+    }
+
+  ledger.Resize (nDevices, battery);
+  if (!resultsDb.empty ())
+    {
+      std::ostringstream params;
+      params << "nDevices=" << nDevices << ";nGateways=" << nGateways
+             << ";simulationTime=" << simulationTime << ";strategy=" << SelectStrategy
+             << ";integrity=" << integrity << ";rangeCulling=" << rangeCulling
+             << ";interferenceIndex=" << interferenceIndex
+             << ";dedupWindow=" << dedupWindow;
+      if (nGateways > 1)
+        params << ";gatewaySites=" << gatewaySites;
+      if (integrity)
+        params << ";syncPeriod=" << syncPeriod << ";sealCyclesPerByte=" << sealCost.cyclesPerByte
+               << ";mcuClockHz=" << sealCost.clockHz << ";mcuCurrent=" << sealCost.activeCurrent;
+      results.reset (new ResultsStore (resultsDb, "sigfox", params.str (),
+                                       RngSeedManager::GetSeed (), RngSeedManager::GetRun ()));
+    }
   /************************
   *  Create the channel  *
   ************************/
 
   NS_LOG_INFO ("Creating the channel...");
+  SetupTimer setup;
+  setup.Phase ("channel");
 
   // Create the sigfox channel object
   Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
@@ -200,20 +416,51 @@ main (int argc, char *argv[])
 
   Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
 
-  Ptr<SigfoxChannel> channel = CreateObject<SigfoxChannel> (loss, delay);
+  Ptr<SigfoxChannel> channel;
+  Ptr<RangeCulledSigfoxChannel> culledChannel;
+  if (rangeCulling)
+    channel = culledChannel = CreateObject<RangeCulledSigfoxChannel> (loss, delay);
+  else
+    channel = CreateObject<SigfoxChannel> (loss, delay);
 
   /************************
   *  Create the helpers  *
   ************************/
 
   NS_LOG_INFO ("Setting up helpers...");
+  setup.Phase ("helpers");
 
-  MobilityHelper mobility;
   Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
   allocator->Add (Vector (0, 0, 0));
   allocator->Add (Vector (0, 0, 0));
-  mobility.SetPositionAllocator (allocator);
-  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  Ptr<PositionAllocator> deviceAllocator = allocator;
+
+  // With several gateways, place them over the Boa Vista area (spread, so
+  // the first k are an even sparser deployment) and the devices uniformly
+  // over the area the site file covers
+  Ptr<ListPositionAllocator> gatewayAllocator = allocator;
+  double areaKm2 = 0;
+  if (nGateways > 1)
+    {
+      std::vector<CellSite> sites = LoadCellSites (gatewaySites);
+      if (nGateways > (int) sites.size ())
+        NS_FATAL_ERROR ("nGateways=" << nGateways << " but " << gatewaySites
+                        << " only lists " << sites.size () << " sites");
+      CellGridIndex extent (sites);
+      areaKm2 = (extent.GetMaxX () - extent.GetMinX ()) * (extent.GetMaxY () - extent.GetMinY ()) / 1e6;
+      sites = SpreadSites (sites);
+      sites.resize (nGateways);
+      gatewayAllocator = CreateObject<ListPositionAllocator> ();
+      for (const CellSite &site : sites)
+        gatewayAllocator->Add (Vector (site.x, site.y, site.z));
+
+      Ptr<RandomRectanglePositionAllocator> area = CreateObject<RandomRectanglePositionAllocator> ();
+      area->SetAttribute ("X", PointerValue (CreateObjectWithAttributes<UniformRandomVariable> (
+        "Min", DoubleValue (extent.GetMinX ()), "Max", DoubleValue (extent.GetMaxX ()))));
+      area->SetAttribute ("Y", PointerValue (CreateObjectWithAttributes<UniformRandomVariable> (
+        "Min", DoubleValue (extent.GetMinY ()), "Max", DoubleValue (extent.GetMaxY ()))));
+      deviceAllocator = area;
+    }
 
   // Create the SigfoxPhyHelper
   SigfoxPhyHelper phyHelper = SigfoxPhyHelper ();
@@ -233,13 +480,14 @@ main (int argc, char *argv[])
   ************************/
 
   NS_LOG_INFO ("Creating the end device...");
+  setup.Phase ("devices");
 
   // Create a set of nodes
   NodeContainer endDevices;
   endDevices.Create (nDevices);
  
   // Assign a mobility model to the node
-  mobility.Install (endDevices);
+  InstallConstantPositions (endDevices, deviceAllocator);
 
   // Create the SigfoxNetDevices of the end devices
   phyHelper.SetDeviceType (SigfoxPhyHelper::EP);
@@ -252,49 +500,88 @@ main (int argc, char *argv[])
    *********************/
 
   NS_LOG_INFO ("Creating the gateway...");
+  setup.Phase ("gateways");
   NodeContainer gateways;
   gateways.Create (nGateways);
 
-  mobility.SetPositionAllocator (allocator);
-  mobility.Install (gateways);
+  InstallConstantPositions (gateways, gatewayAllocator);
 
   // Create a netdevice for each gateway
   phyHelper.SetDeviceType (SigfoxPhyHelper::GW);
   macHelper.SetDeviceType (SigfoxMacHelper::GW);
-  helper.Install (phyHelper, macHelper, gateways);
+  NetDeviceContainer gatewayNetDevices = helper.Install (phyHelper, macHelper, gateways);
+
+  // Network server stand-in: number frames as devices send them and
+  // deduplicate what the gateways forward
+  setup.Phase ("traces");
+  dedup.reset (new DuplicateFilter (Seconds (dedupWindow).GetTimeStep (), nGateways));
+  frameSequence.assign (nDevices, 0);
+  // All end-device PHYs share a type, and so do the gateway ones, so each
+  // trace source is looked up once. The names follow LoraPhy's and
+  // Dockerfile.Sigfox refuses to build without them; a single gateway run
+  // does without the network server, with more gateways it is the point.
+  if (nDevices > 0)
+    {
+      Ptr<SigfoxPhy> first = DynamicCast<SigfoxNetDevice> (endDevicesNetDevices.Get (0))->GetPhy ();
+      TraceHandle startSending (first->GetInstanceTypeId (), "StartSending", nGateways > 1);
+      for (uint32_t i = 0; i < endDevicesNetDevices.GetN () && startSending.IsValid (); ++i)
+        {
+          Ptr<SigfoxPhy> phy = DynamicCast<SigfoxNetDevice> (endDevicesNetDevices.Get (i))->GetPhy ();
+          startSending.Connect (phy, MakeBoundCallback (&FrameSent, i));
+        }
+    }
+  if (gatewayNetDevices.GetN () > 0)
+    {
+      Ptr<SigfoxPhy> firstGateway = DynamicCast<SigfoxNetDevice> (gatewayNetDevices.Get (0))->GetPhy ();
+      TraceHandle receivedPacket (firstGateway->GetInstanceTypeId (), "ReceivedPacket", nGateways > 1);
+      for (uint32_t g = 0; g < gatewayNetDevices.GetN () && receivedPacket.IsValid (); ++g)
+        {
+          Ptr<SigfoxPhy> phy = DynamicCast<SigfoxNetDevice> (gatewayNetDevices.Get (g))->GetPhy ();
+          receivedPacket.Connect (phy, MakeBoundCallback (&GatewayReceived, (uint16_t) g));
+        }
+      TraceHandle interfered (firstGateway->GetInstanceTypeId (), "LostPacketBecauseInterference", false);
+      for (uint32_t g = 0; g < gatewayNetDevices.GetN () && interfered.IsValid (); ++g)
+        {
+          Ptr<SigfoxPhy> phy = DynamicCast<SigfoxNetDevice> (gatewayNetDevices.Get (g))->GetPhy ();
+          interfered.Connect (phy, MakeCallback (&GatewayInterfered));
+        }
+    }
 
   /************************
    * Install Energy Model *
    ************************/
 
-  SdcEnergySourceHelper basicSourceHelper;
-  SigfoxRadioEnergyModelHelper radioEnergyHelper;
+  setup.Phase ("energy");
 
   // configure energy source
-  basicSourceHelper.Set ("SdcEnergySourceInitialEnergyJ", DoubleValue (36000000)); // Energy in J
-  basicSourceHelper.Set ("SdcEnergySupplyVoltageV", DoubleValue (3.3));
+  TypeId sourceTid = SdcEnergySource::GetTypeId ();
+  std::vector<AttributeHandle> sourceAttributes;
+  sourceAttributes.emplace_back (sourceTid, "SdcEnergySourceInitialEnergyJ", DoubleValue (36000000)); // Energy in J
+  sourceAttributes.emplace_back (sourceTid, "SdcEnergySupplyVoltageV", DoubleValue (3.3));
 
-  radioEnergyHelper.Set ("StandbyCurrentA", DoubleValue (4.3));
-  //radioEnergyHelper.Set ("TxCurrentA", DoubleValue (28000));
-  radioEnergyHelper.Set ("TxCurrentA", DoubleValue (47));
-  radioEnergyHelper.Set ("SleepCurrentA", DoubleValue (0.027));
-  radioEnergyHelper.Set ("RxCurrentA", DoubleValue (19));
+  TypeId radioTid = SigfoxRadioEnergyModel::GetTypeId ();
+  std::vector<AttributeHandle> radioAttributes;
+  radioAttributes.emplace_back (radioTid, "StandbyCurrentA", DoubleValue (4.3));
+  //radioAttributes.emplace_back (radioTid, "TxCurrentA", DoubleValue (28000));
+  radioAttributes.emplace_back (radioTid, "TxCurrentA", DoubleValue (47));
+  radioAttributes.emplace_back (radioTid, "SleepCurrentA", DoubleValue (0.027));
+  radioAttributes.emplace_back (radioTid, "RxCurrentA", DoubleValue (19));
 
-  radioEnergyHelper.SetTxCurrentModel ("ns3::ConstantSigfoxTxCurrentModel", "TxCurrent",
-                                       DoubleValue (47));
+  AttributeHandle txCurrent (ConstantSigfoxTxCurrentModel::GetTypeId (), "TxCurrent", DoubleValue (47));
 
   // install source on EDs' nodes
-  EnergySourceContainer sources = basicSourceHelper.Install (endDevices);
+  EnergySourceContainer sources = InstallEnergySources<SdcEnergySource> (endDevices, sourceAttributes);
   Names::Add ("/Names/EnergySource", sources.Get (0));
 
   // install device model
   DeviceEnergyModelContainer deviceModels =
-      radioEnergyHelper.Install (endDevicesNetDevices, sources);
+      InstallSigfoxRadioEnergyModels (endDevicesNetDevices, sources, radioAttributes, txCurrent);
     
 // Power characteristics are measured from the hardware of our case study
 
   /*********************************************************************************/
 
+  setup.Phase ("applications");
   Time appStopTime = Seconds (simulationTime);
   PeriodicSenderHelper appHelper = PeriodicSenderHelper ();
   appHelper.SetPeriod (Seconds (600)); //appPeriodSeconds));
@@ -319,11 +606,17 @@ main (int argc, char *argv[])
   Ptr<DeviceEnergyModel> basicRadioModelPtr =
       basicSourcePtr->FindDeviceEnergyModels ("ns3::SigfoxRadioEnergyModel").Get (0);
   NS_ASSERT (basicRadioModelPtr != NULL);
-  basicRadioModelPtr->TraceConnectWithoutContext ("TotalEnergyConsumption",
-                                                  MakeCallback (&TotalEnergy));
-
   basicRadioModelPtr->TraceConnectWithoutContext ("SystemCurrent", MakeCallback (&syscurrent));
 
+  // Feed every device's radio consumption into its ledger row
+  TraceHandle totalEnergy (basicRadioModelPtr->GetInstanceTypeId (), "TotalEnergyConsumption");
+  for (uint32_t i = 0; i < deviceModels.GetN (); ++i)
+    {
+      totalEnergy.Connect (deviceModels.Get (i), MakeBoundCallback (&TotalEnergy, i));
+    }
+  setup.Stop ();
+  setup.Print (std::cout);
+
   /****************
   *  Simulation  *
   ****************/
@@ -333,10 +626,134 @@ main (int argc, char *argv[])
   NS_LOG_INFO ("Running simulation...");
   Print ();
 
-  Simulator::Schedule (Seconds (60.0), &Measure);
-  Simulator::Schedule (Seconds (86400.0), &SelfDischarge);
+  ScheduleLabelled ("Measure", Seconds (60.0), &Measure);
+  ScheduleLabelled ("SelfDischarge", Seconds (86400.0), &SelfDischarge);
+  ScheduleLabelled ("RotateSentFrames", Seconds (dedupWindow), &RotateSentFrames);
+  if (integrity)
+    {
+      // Keys are provisioned from a fleet master key the server also holds
+      DeviceKey master = {0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+      verifier.reset (new BatchVerifier (master));
+      for (uint32_t i = 0; i < endDevices.GetN (); ++i)
+        {
+          sealers.push_back (FixBatchSealer (i, DeriveDeviceKey (master, i)));
+          deviceMobility.push_back (endDevices.Get (i)->GetObject<MobilityModel> ());
+        }
+      ScheduleLabelled ("SyncBatches", Seconds (syncPeriod), &SyncBatches);
+    }
   Simulator::Run ();
 
+  PrintEventProfile (std::cout, profileTop);
+
+  if (culledChannel && culledChannel->GetGrid ().GetQueries () > 0)
+    {
+      const ReceiverGrid<SigfoxPhy> &grid = culledChannel->GetGrid ();
+      NS_LOG_UNCOND ("Range culling: " << grid.GetMeanCandidates () << " of " << grid.GetSize ()
+        << " PHYs evaluated per transmission over " << grid.GetQueries () << " transmissions");
+      if (grid.GetMeanCandidates () >= grid.GetSize ())
+        NS_LOG_UNCOND ("Range culling: useful range covers every PHY, nothing was culled;"
+          << " raise --ns3::RangeCulledSigfoxChannel::RxThresholdDbm to cull");
+      if (results)
+        results->AddKpi ("culled_candidates_per_tx", grid.GetMeanCandidates ());
+    }
+
+  NS_LOG_UNCOND ("Gateway PHY: " << gatewayReceived << " received, " << gatewayInterfered
+    << " lost to interference");
+  if (results)
+    {
+      results->AddKpi ("gateway_received", gatewayReceived);
+      results->AddKpi ("gateway_lost_interference", gatewayInterfered);
+    }
+
+  dedup->Flush ();
+  // Throughput from a replay in one timed loop; a clock read around every
+  // live Receive would cost as much as the lookup it measures
+  double dedupHostSeconds = 0;
+  if (!forwarded.empty ())
+    {
+      DuplicateFilter replay (Seconds (dedupWindow).GetTimeStep (), nGateways);
+      uint64_t delivered = 0;
+      auto start = std::chrono::steady_clock::now ();
+      for (const ForwardedFrame &f : forwarded)
+        delivered += replay.Receive (f.device, f.sequence, f.gateway, f.time);
+      dedupHostSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+      if (delivered != dedup->GetUnique ())
+        NS_LOG_UNCOND ("Deduplication replay delivered " << delivered << " frames, the live filter "
+          << dedup->GetUnique ());
+    }
+  if (framesSent > 0)
+    {
+      uint64_t heard = 0, receptions = 0;
+      NS_LOG_UNCOND ("Network server: " << framesSent << " frames sent, " << dedup->GetReceptions ()
+        << " gateway receptions, " << dedup->GetUnique () << " delivered after deduplication ("
+        << (dedupHostSeconds > 0 ? dedup->GetReceptions () / dedupHostSeconds : 0.0)
+        << " receptions/s, " << dedup->GetTableBytes () << " B of tables)");
+      NS_LOG_UNCOND ("  " << (double) phyTransmissions / framesSent
+        << " PHY transmissions per frame (repetitions sharing the frame's packet uid)");
+      // Delivery and amplification had only the first k gateways been deployed
+      for (int k = 1; k <= nGateways; ++k)
+        {
+          heard += dedup->GetBestGateway ()[k - 1];
+          receptions += dedup->GetReceptionsPerGateway ()[k - 1];
+          double delivery = (double) heard / framesSent;
+          double amplification = heard > 0 ? (double) receptions / heard : 0.0;
+          NS_LOG_UNCOND ("  " << k << " gateways (" << (areaKm2 > 0 ? k / areaKm2 : 0.0)
+            << " per km2): delivery " << delivery << ", amplification " << amplification);
+          if (results && k < nGateways)
+            {
+              results->AddKpi ("delivery_probability_gw" + std::to_string (k), delivery);
+              results->AddKpi ("amplification_gw" + std::to_string (k), amplification);
+            }
+        }
+      if (results)
+        {
+          results->AddKpi ("frames_sent", framesSent);
+          results->AddKpi ("transmissions_per_frame", (double) phyTransmissions / framesSent);
+          results->AddKpi ("gateway_receptions", dedup->GetReceptions ());
+          results->AddKpi ("delivery_probability", (double) dedup->GetUnique () / framesSent);
+          results->AddKpi ("amplification", dedup->GetUnique () > 0
+                           ? (double) dedup->GetReceptions () / dedup->GetUnique () : 0.0);
+          if (dedupHostSeconds > 0)
+            results->AddKpi ("dedup_receptions_per_s", dedup->GetReceptions () / dedupHostSeconds);
+          results->AddKpi ("dedup_table_bytes", dedup->GetTableBytes ());
+        }
+    }
+
+  if (integrity && sealedBatches > 0)
+    {
+      ledger.Refresh ();
+      double consumed = ledger.GetCapacity (0) - ledger.GetRemaining (0);
+      double share = consumed > 0 ? ledger.GetComputeEnergy (0) / consumed : 0.0;
+      uint64_t fixes = verifier->GetVerifiedBytes () / FIX_RECORD_BYTES;
+      NS_LOG_UNCOND ("Integrity: " << sealedBatches << " batches sealed, "
+        << verifier->GetRejected () << " rejected; device 0 spent " << ledger.GetComputeEnergy (0)
+        << " mAs sealing, " << share * 100 << "% of its consumption and so of its battery life");
+      NS_LOG_UNCOND ("Ingest verification: " << sealedBatches / verifyHostSeconds << " batches/s, "
+        << fixes / verifyHostSeconds << " fixes/s (" << BatchVerifier::GetLanes () << " lanes); sealing "
+        << sealHostSeconds / sealedBatches * 1e9 << " ns/batch on this host");
+      if (results)
+        {
+          results->AddKpi ("integrity_charge_device0", ledger.GetComputeEnergy (0));
+          results->AddKpi ("integrity_share", share);
+          results->AddKpi ("verify_batches_per_s", sealedBatches / verifyHostSeconds);
+          results->AddKpi ("verify_fixes_per_s", fixes / verifyHostSeconds);
+          results->AddKpi ("rejected_batches", verifier->GetRejected ());
+        }
+    }
+
+  if (results)
+    {
+      ledger.Refresh ();
+      results->AddKpi ("mean_remaining", ledger.GetMeanRemaining ());
+      results->AddKpi ("min_remaining", ledger.GetMinRemaining ());
+      results->AddKpi ("depleted_devices", ledger.CountDepleted ());
+      results->AddKpi ("radio_energy_device0", ledger.GetRadioEnergy (0));
+      results->AddKpi ("setup_ms", setup.GetTotalMs ());
+      for (const auto &phase : setup.GetPhases ())
+        results->AddKpi ("setup_" + phase.first + "_ms", phase.second);
+      results.reset ();
+    }
+
   Simulator::Destroy ();
 
   return 0;
@@ -0,0 +1,365 @@
+#ifndef TRACK_STORE_H
+#define TRACK_STORE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== TRACK STORE ====================
+// In-memory store for synced position histories, queried by object, time
+// and area. It has no ns-3 dependency so the web service can link it too
+// (see web/trackstore.cc).
+//
+// Each object's fixes go into chunks that never cross a time partition
+// boundary and hold at most `chunkSize` points. The open chunk keeps raw
+// points; once full it is sealed into three delta + zigzag varint columns
+// (time, x, y), which brings a 1 Hz vehicle fix from 16 bytes down to about
+// 6. Coordinates are quantised to `resolution` (0.01 for metres -> cm, 1e-7
+// for degrees).
+//
+// The spatial index is a fixed-precision grid, like a geohash at one level:
+// every chunk is listed under each cell its points fall in, so a bounding
+// box query only decodes chunks that actually passed through it. Chunks also
+// carry their time span and bounding box for pruning.
+class TrackStore {
+public:
+  struct Point {
+    int64_t time;  // ms
+    double x;
+    double y;
+  };
+
+  TrackStore(double resolution = 0.01, double cellSize = 500.0,
+             int64_t partitionMs = 3600 * 1000, uint32_t chunkSize = 1024)
+    : m_resolution(resolution),
+      m_cellUnits(std::max<int64_t>(1, std::llround(cellSize / resolution))),
+      m_partitionMs(partitionMs),
+      m_chunkSize(chunkSize),
+      m_points(0),
+      m_encodedBytes(0) {}
+
+  void Append(uint64_t object, int64_t time, double x, double y) {
+    Object &obj = GetObject(object);
+    Raw p = {time, Quantise(x), Quantise(y)};
+    Chunk *open = obj.open == NO_CHUNK ? nullptr : &m_chunks[obj.open];
+    if (open == nullptr || open->raw.size() >= m_chunkSize
+        || Partition(time) != Partition(open->raw.front().time)) {
+      if (open != nullptr) {
+        Seal(*open);
+      }
+      obj.open = NewChunk(obj.index);
+      obj.chunks.push_back(obj.open);
+      open = &m_chunks[obj.open];
+    }
+    AddToChunk(obj.open, *open, p);
+    if (!obj.hasLast || time >= obj.last.time) {
+      obj.last = p;
+      obj.hasLast = true;
+    }
+    m_points++;
+  }
+
+  // One sync batch from a device
+  void Append(uint64_t object, const Point *points, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      Append(object, points[i].time, points[i].x, points[i].y);
+    }
+  }
+
+  // Most recent fix by timestamp, regardless of arrival order.
+  bool GetLastLocation(uint64_t object, Point &out) const {
+    auto found = m_objects.find(object);
+    if (found == m_objects.end() || !found->second.hasLast) {
+      return false;
+    }
+    out = ToPoint(found->second.last);
+    return true;
+  }
+
+  // Fixes of one object with from <= time < to, in time order.
+  std::size_t QueryTimeRange(uint64_t object, int64_t from, int64_t to,
+                             std::vector<Point> &out) const {
+    auto found = m_objects.find(object);
+    if (found == m_objects.end()) {
+      return 0;
+    }
+    std::size_t first = out.size();
+    bool sorted = true;
+    int64_t previous = std::numeric_limits<int64_t>::min();
+    for (uint32_t id : found->second.chunks) {
+      const Chunk &chunk = m_chunks[id];
+      if (chunk.maxTime < from || chunk.minTime >= to) {
+        continue;
+      }
+      ForEachPoint(chunk, [&](const Raw &p) {
+        if (p.time >= from && p.time < to) {
+          sorted = sorted && p.time >= previous;
+          previous = p.time;
+          out.push_back(ToPoint(p));
+        }
+      });
+    }
+    if (!sorted) {
+      std::stable_sort(out.begin() + first, out.end(),
+                       [](const Point &a, const Point &b) { return a.time < b.time; });
+    }
+    return out.size() - first;
+  }
+
+  // Calls fn(object, point) for every fix inside the box with
+  // from <= time < to, grouped by chunk.
+  template <typename Fn>
+  void QueryBox(double minX, double minY, double maxX, double maxY,
+                int64_t from, int64_t to, Fn fn) const {
+    int32_t qMinX = Quantise(minX), qMinY = Quantise(minY);
+    int32_t qMaxX = Quantise(maxX), qMaxY = Quantise(maxY);
+    int64_t c0 = Cell(qMinX), c1 = Cell(qMaxX);
+    int64_t r0 = Cell(qMinY), r1 = Cell(qMaxY);
+
+    std::vector<uint32_t> candidates;
+    if ((c1 - c0 + 1) * (r1 - r0 + 1) <= static_cast<int64_t>(m_cells.size())) {
+      for (int64_t c = c0; c <= c1; ++c) {
+        for (int64_t r = r0; r <= r1; ++r) {
+          auto cell = m_cells.find(CellKey(c, r));
+          if (cell != m_cells.end()) {
+            candidates.insert(candidates.end(), cell->second.begin(), cell->second.end());
+          }
+        }
+      }
+    } else {
+      // Box larger than the populated area: walk the index instead
+      for (const auto &cell : m_cells) {
+        int64_t c = static_cast<int32_t>(cell.first >> 32);
+        int64_t r = static_cast<int32_t>(cell.first & 0xffffffff);
+        if (c >= c0 && c <= c1 && r >= r0 && r <= r1) {
+          candidates.insert(candidates.end(), cell.second.begin(), cell.second.end());
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (uint32_t id : candidates) {
+      const Chunk &chunk = m_chunks[id];
+      if (chunk.maxTime < from || chunk.minTime >= to
+          || chunk.maxX < qMinX || chunk.minX > qMaxX
+          || chunk.maxY < qMinY || chunk.minY > qMaxY) {
+        continue;
+      }
+      uint64_t object = m_objectIds[chunk.object];
+      ForEachPoint(chunk, [&](const Raw &p) {
+        if (p.time >= from && p.time < to && p.x >= qMinX && p.x <= qMaxX
+            && p.y >= qMinY && p.y <= qMaxY) {
+          fn(object, ToPoint(p));
+        }
+      });
+    }
+  }
+
+  std::size_t GetSize() const { return m_points; }
+  std::size_t GetObjectCount() const { return m_objects.size(); }
+
+  // Approximate bytes held by point data (sealed columns plus open chunks)
+  std::size_t GetDataBytes() const {
+    std::size_t open = 0;
+    for (const auto &obj : m_objects) {
+      if (obj.second.open != NO_CHUNK) {
+        open += m_chunks[obj.second.open].raw.size() * sizeof(Raw);
+      }
+    }
+    return m_encodedBytes + open;
+  }
+
+private:
+  static const uint32_t NO_CHUNK = 0xffffffff;
+
+  struct Raw {
+    int64_t time;
+    int32_t x;
+    int32_t y;
+  };
+
+  struct Chunk {
+    uint32_t object;  // index into m_objectIds
+    uint32_t count;
+    int64_t minTime, maxTime;
+    int32_t minX, maxX, minY, maxY;
+    std::vector<Raw> raw;       // while open
+    std::vector<uint8_t> data;  // once sealed: time | x | y columns
+    uint32_t xOffset, yOffset;
+    std::vector<uint64_t> cells;
+  };
+
+  struct Object {
+    Object() : index(0), open(NO_CHUNK), hasLast(false) {}
+    uint32_t index;
+    uint32_t open;
+    std::vector<uint32_t> chunks;
+    Raw last;
+    bool hasLast;
+  };
+
+  Object &GetObject(uint64_t object) {
+    auto found = m_objects.find(object);
+    if (found != m_objects.end()) {
+      return found->second;
+    }
+    Object &obj = m_objects[object];
+    obj.index = m_objectIds.size();
+    m_objectIds.push_back(object);
+    return obj;
+  }
+
+  uint32_t NewChunk(uint32_t object) {
+    Chunk chunk;
+    chunk.object = object;
+    chunk.count = 0;
+    chunk.minTime = std::numeric_limits<int64_t>::max();
+    chunk.maxTime = std::numeric_limits<int64_t>::min();
+    chunk.minX = chunk.minY = std::numeric_limits<int32_t>::max();
+    chunk.maxX = chunk.maxY = std::numeric_limits<int32_t>::min();
+    chunk.xOffset = chunk.yOffset = 0;
+    chunk.raw.reserve(m_chunkSize);
+    m_chunks.push_back(std::move(chunk));
+    return m_chunks.size() - 1;
+  }
+
+  void AddToChunk(uint32_t id, Chunk &chunk, const Raw &p) {
+    chunk.raw.push_back(p);
+    chunk.count++;
+    chunk.minTime = std::min(chunk.minTime, p.time);
+    chunk.maxTime = std::max(chunk.maxTime, p.time);
+    chunk.minX = std::min(chunk.minX, p.x);
+    chunk.maxX = std::max(chunk.maxX, p.x);
+    chunk.minY = std::min(chunk.minY, p.y);
+    chunk.maxY = std::max(chunk.maxY, p.y);
+    uint64_t key = CellKey(Cell(p.x), Cell(p.y));
+    // Consecutive fixes are almost always in the same cell
+    if (chunk.cells.empty() || chunk.cells.back() != key) {
+      if (std::find(chunk.cells.begin(), chunk.cells.end(), key) == chunk.cells.end()) {
+        chunk.cells.push_back(key);
+        m_cells[key].push_back(id);
+      } else {
+        // Keep the current cell last for the fast path
+        std::iter_swap(std::find(chunk.cells.begin(), chunk.cells.end(), key), chunk.cells.end() - 1);
+      }
+    }
+  }
+
+  void Seal(Chunk &chunk) {
+    std::vector<uint8_t> &data = chunk.data;
+    data.reserve(chunk.raw.size() * 6);
+    int64_t previous = 0;
+    for (const Raw &p : chunk.raw) {
+      PutVarint(data, ZigZag(p.time - previous));
+      previous = p.time;
+    }
+    chunk.xOffset = data.size();
+    previous = 0;
+    for (const Raw &p : chunk.raw) {
+      PutVarint(data, ZigZag(p.x - previous));
+      previous = p.x;
+    }
+    chunk.yOffset = data.size();
+    previous = 0;
+    for (const Raw &p : chunk.raw) {
+      PutVarint(data, ZigZag(p.y - previous));
+      previous = p.y;
+    }
+    data.shrink_to_fit();
+    std::vector<Raw>().swap(chunk.raw);
+    std::vector<uint64_t>(chunk.cells).swap(chunk.cells);
+    m_encodedBytes += data.size();
+  }
+
+  template <typename Fn>
+  static void ForEachPoint(const Chunk &chunk, Fn fn) {
+    if (chunk.data.empty()) {
+      for (const Raw &p : chunk.raw) {
+        fn(p);
+      }
+      return;
+    }
+    const uint8_t *t = chunk.data.data();
+    const uint8_t *x = t + chunk.xOffset;
+    const uint8_t *y = t + chunk.yOffset;
+    Raw p = {0, 0, 0};
+    for (uint32_t i = 0; i < chunk.count; ++i) {
+      p.time += UnZigZag(GetVarint(t));
+      p.x += static_cast<int32_t>(UnZigZag(GetVarint(x)));
+      p.y += static_cast<int32_t>(UnZigZag(GetVarint(y)));
+      fn(p);
+    }
+  }
+
+  static uint64_t ZigZag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+  }
+
+  static int64_t UnZigZag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+  }
+
+  static void PutVarint(std::vector<uint8_t> &out, uint64_t v) {
+    while (v >= 0x80) {
+      out.push_back(static_cast<uint8_t>(v) | 0x80);
+      v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+  }
+
+  static uint64_t GetVarint(const uint8_t *&in) {
+    uint64_t v = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+      v |= static_cast<uint64_t>(*in++ & 0x7f) << shift;
+      shift += 7;
+    }
+    return v | static_cast<uint64_t>(*in++) << shift;
+  }
+
+  int32_t Quantise(double v) const {
+    double q = std::round(v / m_resolution);
+    return static_cast<int32_t>(std::max(std::min(q, 2147483647.0), -2147483648.0));
+  }
+
+  Point ToPoint(const Raw &p) const {
+    Point out = {p.time, p.x * m_resolution, p.y * m_resolution};
+    return out;
+  }
+
+  int64_t Cell(int32_t q) const {
+    int64_t v = q;
+    return v >= 0 ? v / m_cellUnits : -((-v - 1) / m_cellUnits) - 1;
+  }
+
+  static uint64_t CellKey(int64_t col, int64_t row) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(col)) << 32 | static_cast<uint32_t>(row);
+  }
+
+  int64_t Partition(int64_t time) const {
+    return time >= 0 ? time / m_partitionMs : -((-time - 1) / m_partitionMs) - 1;
+  }
+
+  double m_resolution;
+  int64_t m_cellUnits;
+  int64_t m_partitionMs;
+  uint32_t m_chunkSize;
+
+  std::unordered_map<uint64_t, Object> m_objects;
+  std::vector<uint64_t> m_objectIds;
+  std::vector<Chunk> m_chunks;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;
+  std::size_t m_points;
+  std::size_t m_encodedBytes;
+};
+
+} // namespace ns3
+
+#endif /* TRACK_STORE_H */
@@ -0,0 +1,270 @@
+#ifndef TRACKER_PAYLOAD_H
+#define TRACKER_PAYLOAD_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "dead_reckoning.h"
+#include "scenario_builder.h"
+
+#include <cmath>
+#include <vector>
+
+namespace ns3 {
+
+// ==================== FIX HEADER ====================
+// Wire format of one position report. Coordinates are the simulation's
+// projected metres in centimetre fixed point, so a decoded fix matches the
+// mobility model to 1 cm.
+class TrackerFixHeader : public Header {
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::TrackerFixHeader")
+      .SetParent<Header>()
+      .AddConstructor<TrackerFixHeader>();
+    return tid;
+  }
+
+  TrackerFixHeader()
+    : m_deviceId(0), m_sequence(0), m_timestampMs(0),
+      m_x(0), m_y(0), m_z(0), m_speed(0), m_heading(0) {}
+
+  TypeId GetInstanceTypeId() const override { return GetTypeId(); }
+
+  uint32_t GetSerializedSize() const override { return SERIALIZED_SIZE; }
+
+  void Serialize(Buffer::Iterator start) const override {
+    start.WriteHtonU32(m_deviceId);
+    start.WriteHtonU32(m_sequence);
+    start.WriteHtonU64(m_timestampMs);
+    start.WriteHtonU32(static_cast<uint32_t>(m_x));
+    start.WriteHtonU32(static_cast<uint32_t>(m_y));
+    start.WriteHtonU32(static_cast<uint32_t>(m_z));
+    start.WriteHtonU16(m_speed);
+    start.WriteHtonU16(m_heading);
+  }
+
+  uint32_t Deserialize(Buffer::Iterator start) override {
+    m_deviceId = start.ReadNtohU32();
+    m_sequence = start.ReadNtohU32();
+    m_timestampMs = start.ReadNtohU64();
+    m_x = static_cast<int32_t>(start.ReadNtohU32());
+    m_y = static_cast<int32_t>(start.ReadNtohU32());
+    m_z = static_cast<int32_t>(start.ReadNtohU32());
+    m_speed = start.ReadNtohU16();
+    m_heading = start.ReadNtohU16();
+    return SERIALIZED_SIZE;
+  }
+
+  void Print(std::ostream &os) const override {
+    os << "device=" << m_deviceId << " seq=" << m_sequence
+       << " t=" << m_timestampMs << "ms pos=" << GetPosition()
+       << " speed=" << GetSpeed() << "m/s heading=" << GetHeading() << "deg";
+  }
+
+  // Fills the header from the node's mobility model at the current time.
+  void SetFix(uint32_t deviceId, uint32_t sequence, Ptr<const MobilityModel> mobility) {
+    Vector position = mobility->GetPosition();
+    Vector velocity = mobility->GetVelocity();
+    double speed = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+    double heading = std::atan2(velocity.y, velocity.x) * 180.0 / M_PI;
+
+    m_deviceId = deviceId;
+    m_sequence = sequence;
+    m_timestampMs = Simulator::Now().GetMilliSeconds();
+    m_x = static_cast<int32_t>(std::lround(position.x * 100));
+    m_y = static_cast<int32_t>(std::lround(position.y * 100));
+    m_z = static_cast<int32_t>(std::lround(position.z * 100));
+    m_speed = static_cast<uint16_t>(std::min(std::lround(speed * 100), 65535L));
+    m_heading = static_cast<uint16_t>(std::lround((heading < 0 ? heading + 360 : heading) * 100) % 36000);
+  }
+
+  uint32_t GetDeviceId() const { return m_deviceId; }
+  uint32_t GetSequence() const { return m_sequence; }
+  Time GetTimestamp() const { return MilliSeconds(m_timestampMs); }
+  Vector GetPosition() const { return Vector(m_x / 100.0, m_y / 100.0, m_z / 100.0); }
+  double GetSpeed() const { return m_speed / 100.0; }
+  double GetHeading() const { return m_heading / 100.0; }
+
+  Vector GetVelocity() const {
+    double heading = GetHeading() * M_PI / 180.0;
+    return Vector(GetSpeed() * std::cos(heading), GetSpeed() * std::sin(heading), 0);
+  }
+
+  static const uint32_t SERIALIZED_SIZE = 32;
+
+private:
+  uint32_t m_deviceId;
+  uint32_t m_sequence;
+  uint64_t m_timestampMs;
+  int32_t m_x;
+  int32_t m_y;
+  int32_t m_z;
+  uint16_t m_speed;    // cm/s
+  uint16_t m_heading;  // 0.01 degree, counter-clockwise from +x
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TrackerFixHeader);
+
+// ==================== APPLICATION ====================
+// Periodically sends the node's current fix over UDP. The header is
+// serialised straight into the packet's buffer, with no intermediate byte
+// array to copy from, and the padding after it stays in the buffer's virtual
+// zero area, so it is never allocated or zeroed.
+//
+// With a non-zero ErrorBound the position is still checked every Interval,
+// but only reported when it has drifted further than that from where the
+// server's dead-reckoning predictor puts it (or after MaxSilence).
+class TrackerPayloadApplication : public Application {
+public:
+  static TypeId GetTypeId() {
+    static TypeId tid = TypeId("ns3::TrackerPayloadApplication")
+      .SetParent<Application>()
+      .AddConstructor<TrackerPayloadApplication>()
+      .AddAttribute("RemoteAddress", "Destination IPv4 address of the reports.",
+                    AddressValue(),
+                    MakeAddressAccessor(&TrackerPayloadApplication::m_peerAddress),
+                    MakeAddressChecker())
+      .AddAttribute("RemotePort", "Destination UDP port of the reports.",
+                    UintegerValue(5000),
+                    MakeUintegerAccessor(&TrackerPayloadApplication::m_peerPort),
+                    MakeUintegerChecker<uint16_t>())
+      .AddAttribute("Interval", "Time between reports.",
+                    TimeValue(Seconds(1.0)),
+                    MakeTimeAccessor(&TrackerPayloadApplication::m_interval),
+                    MakeTimeChecker())
+      .AddAttribute("PacketSize", "Report size in bytes; anything past the fix is zero padding.",
+                    UintegerValue(TrackerFixHeader::SERIALIZED_SIZE),
+                    MakeUintegerAccessor(&TrackerPayloadApplication::m_packetSize),
+                    MakeUintegerChecker<uint32_t>(TrackerFixHeader::SERIALIZED_SIZE))
+      .AddAttribute("ErrorBound", "Dead-reckoning error that triggers a report, in metres (0 = every Interval).",
+                    DoubleValue(0),
+                    MakeDoubleAccessor(&TrackerPayloadApplication::m_errorBound),
+                    MakeDoubleChecker<double>(0))
+      .AddAttribute("MaxSilence", "Longest time without a report when ErrorBound is set.",
+                    TimeValue(Seconds(300)),
+                    MakeTimeAccessor(&TrackerPayloadApplication::m_maxSilence),
+                    MakeTimeChecker())
+      .AddTraceSource("Tx", "A report has been sent.",
+                      MakeTraceSourceAccessor(&TrackerPayloadApplication::m_txTrace),
+                      "ns3::Packet::TracedCallback");
+    return tid;
+  }
+
+  TrackerPayloadApplication()
+    : m_policy(0, Seconds(0)), m_sequence(0), m_bytesSent(0), m_suppressed(0) {}
+
+  uint32_t GetReportsSent() const { return m_sequence; }
+  uint32_t GetReportsSuppressed() const { return m_suppressed; }
+  uint64_t GetBytesSent() const { return m_bytesSent; }
+
+  double GetBytesPerSecond() const {
+    double elapsed = (Simulator::Now() - m_startTime).GetSeconds();
+    return elapsed > 0 ? m_bytesSent / elapsed : 0.0;
+  }
+
+protected:
+  void DoDispose() override {
+    m_socket = nullptr;
+    m_mobility = nullptr;
+    Application::DoDispose();
+  }
+
+private:
+  void StartApplication() override {
+    m_mobility = GetNode()->GetObject<MobilityModel>();
+    NS_ASSERT_MSG(m_mobility != nullptr, "TrackerPayloadApplication needs a mobility model");
+
+    if (m_socket == nullptr) {
+      m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+      m_socket->Bind();
+      m_socket->Connect(InetSocketAddress(Ipv4Address::ConvertFrom(m_peerAddress), m_peerPort));
+    }
+    m_policy = DeadReckoningPolicy(m_errorBound, m_maxSilence);
+    m_startTime = Simulator::Now();
+    m_sendEvent = Simulator::ScheduleNow(&TrackerPayloadApplication::Send, this);
+  }
+
+  void StopApplication() override {
+    m_sendEvent.Cancel();
+  }
+
+  void Send() {
+    if (m_errorBound <= 0 || m_policy.ShouldReport(Simulator::Now(), m_mobility->GetPosition())) {
+      SendFix();
+    } else {
+      m_suppressed++;
+    }
+    m_sendEvent = Simulator::Schedule(m_interval, &TrackerPayloadApplication::Send, this);
+  }
+
+  void SendFix() {
+    TrackerFixHeader fix;
+    fix.SetFix(GetNode()->GetId(), m_sequence, m_mobility);
+
+    Ptr<Packet> packet = Create<Packet>(m_packetSize - TrackerFixHeader::SERIALIZED_SIZE);
+    packet->AddHeader(fix);
+    if (m_socket->Send(packet) >= 0) {
+      m_sequence++;
+      m_bytesSent += packet->GetSize();
+      m_policy.OnReport(fix.GetTimestamp(), fix.GetPosition(), fix.GetVelocity());
+      m_txTrace(packet);
+    }
+  }
+
+  Address m_peerAddress;
+  uint16_t m_peerPort;
+  Time m_interval;
+  uint32_t m_packetSize;
+  double m_errorBound;
+  Time m_maxSilence;
+
+  Ptr<Socket> m_socket;
+  Ptr<MobilityModel> m_mobility;
+  EventId m_sendEvent;
+  DeadReckoningPolicy m_policy;
+  Time m_startTime;
+  uint32_t m_sequence;
+  uint64_t m_bytesSent;
+  uint32_t m_suppressed;
+  TracedCallback<Ptr<const Packet>> m_txTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TrackerPayloadApplication);
+
+// ==================== HELPER ====================
+// Attributes are resolved when set, so Install only writes them through
+// their accessors (see AttributeHandle); a name set twice ends up with the
+// later value, as with an ObjectFactory.
+class TrackerPayloadHelper {
+public:
+  TrackerPayloadHelper(Address address, uint16_t port) {
+    SetAttribute("RemoteAddress", AddressValue(address));
+    SetAttribute("RemotePort", UintegerValue(port));
+  }
+
+  void SetAttribute(std::string name, const AttributeValue &value) {
+    m_attributes.emplace_back(TrackerPayloadApplication::GetTypeId(), name, value);
+  }
+
+  ApplicationContainer Install(NodeContainer nodes) const {
+    ApplicationContainer apps;
+    for (NodeContainer::Iterator it = nodes.Begin(); it != nodes.End(); ++it) {
+      Ptr<TrackerPayloadApplication> app = CreateObject<TrackerPayloadApplication>();
+      for (const AttributeHandle &attribute : m_attributes) {
+        attribute.Apply(app);
+      }
+      (*it)->AddApplication(app);
+      apps.Add(app);
+    }
+    return apps;
+  }
+
+private:
+  std::vector<AttributeHandle> m_attributes;
+};
+
+} // namespace ns3
+
+#endif /* TRACKER_PAYLOAD_H */
@@ -8,6 +8,10 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/buildings-helper.h"
 #include "ns3/yans-error-rate-model.h"
+#include "replication_runner.h"
+#include "results_store.h"
+#include "event_profiler.h"
+#include "culled_wifi_channel.h"
 #include <cmath>
 
 using namespace ns3;
@@ -19,6 +23,9 @@ uint32_t totalPacketsSent = 0;
 uint32_t totalPacketsLost = 0;
 double totalEnergyConsumed = 0.0;
 double maxBufferBeforeSync = 0.0;
+bool profile = false;                  // Event loop profile after each run
+uint32_t profileTop = 20;
+bool rangeCulling = false;             // Only deliver to PHYs within useful range
 
 // Configure these parameters
 const int NUM_AP = 3;                  // Number of WiFi access points
@@ -26,6 +33,9 @@ const int NUM_NODES = 10;              // Number of mobile nodes
 const double COVERAGE_RADIUS = 50.0;   // Meters
 const double SIM_TIME = 300.0;         // Seconds
 
+// KPIs reported by RunScenario, in order
+const std::vector<std::string> KPI_NAMES = {"energy_wh", "loss_rate_pct", "delay_ms"};
+
 // Helper function to calculate Euclidean distance
 double CustomCalculateDistance(const Vector &a, const Vector &b) {
   double dx = a.x - b.x;
@@ -57,7 +67,7 @@ void TrackNodePosition(Ptr<Node> node) {
     maxBufferBeforeSync = 0;
   }
 
-  Simulator::Schedule(Seconds(0.1), &TrackNodePosition, node);
+  ScheduleLabelled("TrackNodePosition", Seconds(0.1), &TrackNodePosition, node);
 }
 
 // Updated callback matching the expected signature: (double oldEnergy, double newEnergy)
@@ -67,19 +77,9 @@ void EnergyConsumptionCallback(double oldEnergy, double newEnergy) {
                 << " J at " << Simulator::Now().GetSeconds() << " s");
 }
 
-int main(int argc, char *argv[]) {
-  uint32_t seed = static_cast<uint32_t>(std::time(nullptr)); // Default to current time
-
-  // Set simulation parameters
-  double simTime = SIM_TIME;
-  CommandLine cmd;
-  cmd.AddValue("seed", "Random seed value", seed);
-  cmd.AddValue("simTime", "Total duration of the simulation", simTime);
-  cmd.Parse(argc, argv);
-
-  RngSeedManager::SetSeed(seed);
-  std::cout << "Using seed: " << seed << std::endl;
-
+// Builds and runs one replication, returning its KPIs in the order of
+// KPI_NAMES. The RNG seed and run number must already be set.
+std::vector<double> RunScenario(double simTime, const std::string &resultsDb) {
   // WiFi configuration defaults
   Config::SetDefault("ns3::RangePropagationLossModel::MaxRange", DoubleValue(COVERAGE_RADIUS));
   Config::SetDefault("ns3::WifiRemoteStationManager::RtsCtsThreshold", StringValue("2200"));
@@ -116,10 +116,23 @@ int main(int argc, char *argv[]) {
   WifiHelper wifi;
   wifi.SetStandard(WIFI_STANDARD_80211n);
 
-  YansWifiChannelHelper channelHelper = YansWifiChannelHelper::Default();
-  channelHelper.AddPropagationLoss("ns3::LogDistancePropagationLossModel",
-                                 "Exponent", DoubleValue(3.0));
-  Ptr<YansWifiChannel> wifiChannel = channelHelper.Create();
+  Ptr<YansWifiChannel> wifiChannel;
+  Ptr<RangeCulledYansWifiChannel> culledChannel;
+  if (rangeCulling) {
+    // Same models as the helper below builds: its default LogDistance,
+    // chained to the extra one, and a constant-speed delay
+    Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel>();
+    Ptr<LogDistancePropagationLossModel> extraLoss = CreateObject<LogDistancePropagationLossModel>();
+    extraLoss->SetAttribute("Exponent", DoubleValue(3.0));
+    loss->SetNext(extraLoss);
+    Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel>();
+    wifiChannel = culledChannel = CreateObject<RangeCulledYansWifiChannel>(loss, delay);
+  } else {
+    YansWifiChannelHelper channelHelper = YansWifiChannelHelper::Default();
+    channelHelper.AddPropagationLoss("ns3::LogDistancePropagationLossModel",
+                                   "Exponent", DoubleValue(3.0));
+    wifiChannel = channelHelper.Create();
+  }
 
   YansWifiPhyHelper phy;
   phy.SetErrorRateModel("ns3::YansErrorRateModel");
@@ -184,23 +197,39 @@ int main(int argc, char *argv[]) {
 
   // Schedule tracking of station positions
   for (uint32_t i = 0; i < staNodes.GetN(); ++i) {
-    Simulator::Schedule(Seconds(0.1), &TrackNodePosition, staNodes.Get(i));
+    ScheduleLabelled("TrackNodePosition", Seconds(0.1), &TrackNodePosition, staNodes.Get(i));
   }
 
   // Flow monitor configuration
   FlowMonitorHelper flowHelper;
   Ptr<FlowMonitor> monitor = flowHelper.InstallAll();
 
+  if (profile) {
+    EnableEventProfiler();
+  }
   Simulator::Stop(Seconds(simTime));
   Simulator::Run();
+  PrintEventProfile(std::cout, profileTop);
+
+  double culledCandidates = 0;
+  if (culledChannel && culledChannel->GetGrid().GetQueries() > 0) {
+    const ReceiverGrid<YansWifiPhy> &grid = culledChannel->GetGrid();
+    culledCandidates = grid.GetMeanCandidates();
+    std::cout << "Range culling: " << culledCandidates << " of " << grid.GetSize()
+              << " PHYs evaluated per transmission over " << grid.GetQueries()
+              << " transmissions" << std::endl;
+  }
 
   // Calculate flow metrics
   monitor->CheckForLostPackets();
   Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier());
   FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
+  // delaySum only covers packets that arrived, so it is averaged over rxPackets
   Time totalDelay = Seconds(0);
+  uint32_t totalPacketsReceived = 0;
   for (auto const& stat : stats) {
     totalDelay += stat.second.delaySum;
+    totalPacketsReceived += stat.second.rxPackets;
     totalPacketsSent += stat.second.txPackets;
     totalPacketsLost += stat.second.lostPackets;
   }
@@ -210,12 +239,15 @@ int main(int argc, char *argv[]) {
     totalEnergyConsumed += ((10000.0 - (*it)->GetRemainingEnergy()) / 3600.0);
   }
 
+  double lossRate = totalPacketsSent > 0 ? totalPacketsLost * 100.0 / totalPacketsSent : 0.0;
+  double avgDelay = totalPacketsReceived > 0 ? totalDelay.GetSeconds() * 1000.0 / totalPacketsReceived : 0.0;
+
   // Output results to stdout
-  std::cout << "\n=== Simulation Results ===\n"
+  std::cout << "\n=== Simulation Results (run " << RngSeedManager::GetRun() << ") ===\n"
             << "Total energy consumed: " << totalEnergyConsumed << " Wh\n"
             << "Out-of-coverage time: " << totalOutOfCoverageTime << " seconds\n"
-            << "Packet loss rate: " << (totalPacketsLost * 100.0 / totalPacketsSent) << "%\n"
-            << "Average packet delay: " << (totalDelay.GetMilliSeconds() / totalPacketsSent) << " ms\n"
+            << "Packet loss rate: " << lossRate << "%\n"
+            << "Average packet delay: " << avgDelay << " ms\n"
             << "Max data stored before sync: " << (maxBufferBeforeSync / 1000) << " MB\n";
 
   // Connect energy trace callback
@@ -224,5 +256,51 @@ int main(int argc, char *argv[]) {
   }
 
   Simulator::Destroy();
+
+  std::vector<double> kpis = {totalEnergyConsumed, lossRate, avgDelay};
+  if (!resultsDb.empty()) {
+    std::ostringstream params;
+    params << "simTime=" << simTime << ";nodes=" << NUM_NODES << ";aps=" << NUM_AP
+           << ";rangeCulling=" << rangeCulling;
+    ResultsStore results(resultsDb, "wifi", params.str(), RngSeedManager::GetSeed(), RngSeedManager::GetRun());
+    for (uint32_t k = 0; k < kpis.size(); ++k) {
+      results.AddKpi(KPI_NAMES[k], kpis[k]);
+    }
+    results.AddKpi("out_of_coverage_s", totalOutOfCoverageTime);
+    if (culledCandidates > 0) {
+      results.AddKpi("culled_candidates_per_tx", culledCandidates);
+    }
+  }
+  return kpis;
+}
+
+int main(int argc, char *argv[]) {
+  // Set simulation parameters
+  double simTime = SIM_TIME;
+  bool replicate = false;
+  std::string resultsDb = "logs/results.db";
+  ReplicationRunner runner(KPI_NAMES);
+
+  CommandLine cmd;
+  cmd.AddValue("simTime", "Total duration of the simulation", simTime);
+  cmd.AddValue("replicate", "Run replications until every KPI confidence interval converges", replicate);
+  cmd.AddValue("resultsDb", "SQLite results database, relative to the ns-3 root (empty to disable)", resultsDb);
+  cmd.AddValue("profile", "Print a wall-time profile of the event loop after each run", profile);
+  cmd.AddValue("profileTop", "Event types and nodes listed in the profile", profileTop);
+  cmd.AddValue("rangeCulling", "Skip receivers beyond useful range on the channel", rangeCulling);
+  runner.AddValues(cmd);
+  cmd.Parse(argc, argv);
+
+  std::cout << "Using seed: " << runner.GetSeed() << std::endl;
+
+  if (!replicate) {
+    RngSeedManager::SetSeed(runner.GetSeed());
+    RngSeedManager::SetRun(runner.GetFirstRun());
+    RunScenario(simTime, resultsDb);
+    return 0;
+  }
+
+  runner.Run([simTime, resultsDb](uint32_t) { return RunScenario(simTime, resultsDb); });
+  runner.Print(std::cout);
   return 0;
 }
@@ -3,21 +3,137 @@ package main
 import (
 	"encoding/json"
 	"fmt"
+	"math"
 	"net/http"
 	"os"
+	"strconv"
+	"time"
 )
 
 func main() {
+	store := NewTrackStore()
+	defer store.Close()
+
 	http.DefaultServeMux.HandleFunc("/", func(w http.ResponseWriter, r *http.Request) {
-		w.Header().Set("Content-Type", "application/json")
-		w.WriteHeader(http.StatusOK)
-		json.NewEncoder(w).Encode(map[string]interface{}{
+		writeJSON(w, http.StatusOK, map[string]interface{}{
 			"message": "Hello, World",
 		})
 	})
 
+	// Recebe um lote de pontos coletados pelo rastreador desde a última sincronização.
+	http.DefaultServeMux.HandleFunc("POST /objects/{id}/sync", func(w http.ResponseWriter, r *http.Request) {
+		id, err := strconv.ParseInt(r.PathValue("id"), 10, 64)
+		if err != nil {
+			writeError(w, http.StatusBadRequest, err)
+			return
+		}
+
+		var trackInfo []TrackInfo
+		if err := json.NewDecoder(r.Body).Decode(&trackInfo); err != nil {
+			writeError(w, http.StatusBadRequest, err)
+			return
+		}
+
+		store.Object(id).SyncTrackingHistory(trackInfo)
+		writeJSON(w, http.StatusOK, map[string]interface{}{
+			"synced": len(trackInfo),
+		})
+	})
+
+	http.DefaultServeMux.HandleFunc("GET /objects/{id}/last", func(w http.ResponseWriter, r *http.Request) {
+		id, err := strconv.ParseInt(r.PathValue("id"), 10, 64)
+		if err != nil {
+			writeError(w, http.StatusBadRequest, err)
+			return
+		}
+
+		trackInfo, ok := store.LastLocation(id)
+		if !ok {
+			writeError(w, http.StatusNotFound, fmt.Errorf("objeto %d sem histórico", id))
+			return
+		}
+
+		writeJSON(w, http.StatusOK, trackInfo)
+	})
+
+	// Histórico de um objeto; from e to (RFC 3339) são opcionais.
+	http.DefaultServeMux.HandleFunc("GET /objects/{id}/history", func(w http.ResponseWriter, r *http.Request) {
+		id, err := strconv.ParseInt(r.PathValue("id"), 10, 64)
+		if err != nil {
+			writeError(w, http.StatusBadRequest, err)
+			return
+		}
+
+		from, to, err := parseInterval(r)
+		if err != nil {
+			writeError(w, http.StatusBadRequest, err)
+			return
+		}
+
+		writeJSON(w, http.StatusOK, store.History(id, from, to))
+	})
+
+	// Pontos de todos os objetos dentro de um retângulo (minLat, minLon, maxLat, maxLon).
+	http.DefaultServeMux.HandleFunc("GET /area", func(w http.ResponseWriter, r *http.Request) {
+		var bounds [4]float64
+		for i, name := range []string{"minLat", "minLon", "maxLat", "maxLon"} {
+			value, err := strconv.ParseFloat(r.URL.Query().Get(name), 64)
+			if err != nil {
+				writeError(w, http.StatusBadRequest, fmt.Errorf("%s: %w", name, err))
+				return
+			}
+			bounds[i] = value
+		}
+
+		from, to, err := parseInterval(r)
+		if err != nil {
+			writeError(w, http.StatusBadRequest, err)
+			return
+		}
+
+		writeJSON(w, http.StatusOK, store.InArea(bounds[0], bounds[1], bounds[2], bounds[3], from, to))
+	})
+
 	if err := http.ListenAndServe(":8080", nil); err != nil {
 		fmt.Fprintln(os.Stderr, err)
 		os.Exit(1)
 	}
 }
+
+// parseInterval lê os parâmetros from e to; sem eles o intervalo é ilimitado.
+// Os limites abertos são os extremos de int64 em milissegundos, que
+// sobrevivem ao UnixMilli() usado na consulta ao armazenamento.
+func parseInterval(r *http.Request) (time.Time, time.Time, error) {
+	from := time.UnixMilli(math.MinInt64)
+	to := time.UnixMilli(math.MaxInt64)
+
+	if value := r.URL.Query().Get("from"); value != "" {
+		t, err := time.Parse(time.RFC3339, value)
+		if err != nil {
+			return from, to, fmt.Errorf("from: %w", err)
+		}
+		from = t
+	}
+
+	if value := r.URL.Query().Get("to"); value != "" {
+		t, err := time.Parse(time.RFC3339, value)
+		if err != nil {
+			return from, to, fmt.Errorf("to: %w", err)
+		}
+		to = t
+	}
+
+	return from, to, nil
+}
+
+func writeJSON(w http.ResponseWriter, status int, v interface{}) {
+	w.Header().Set("Content-Type", "application/json")
+	w.WriteHeader(status)
+	json.NewEncoder(w).Encode(v)
+}
+
+func writeError(w http.ResponseWriter, status int, err error) {
+	writeJSON(w, status, map[string]interface{}{
+		"error": err.Error(),
+	})
+}
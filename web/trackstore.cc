@@ -0,0 +1,85 @@
+#include "trackstore.h"
+#include "track_store.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Coordenadas em graus: resolução de 1e-7 (~1 cm), células de 0,005° (~550 m)
+// e partições de uma hora.
+struct track_store {
+  track_store() : store(1e-7, 0.005, 3600 * 1000, 1024) {}
+  ns3::TrackStore store;
+};
+
+namespace {
+
+template <typename T>
+T *Copy(const std::vector<T> &v) {
+  if (v.empty()) {
+    return nullptr;
+  }
+  T *out = static_cast<T *>(std::malloc(v.size() * sizeof(T)));
+  std::memcpy(out, v.data(), v.size() * sizeof(T));
+  return out;
+}
+
+track_point ToC(const ns3::TrackStore::Point &p) {
+  track_point out = {p.time, p.y, p.x};
+  return out;
+}
+
+} // namespace
+
+extern "C" {
+
+track_store *track_store_new(void) { return new track_store(); }
+
+void track_store_free(track_store *store) { delete store; }
+
+void track_store_append(track_store *store, int64_t object, const track_point *points, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    store->store.Append(object, points[i].time_ms, points[i].lon, points[i].lat);
+  }
+}
+
+int track_store_last(const track_store *store, int64_t object, track_point *out) {
+  ns3::TrackStore::Point p;
+  if (!store->store.GetLastLocation(object, p)) {
+    return 0;
+  }
+  *out = ToC(p);
+  return 1;
+}
+
+size_t track_store_range(const track_store *store, int64_t object, int64_t from_ms, int64_t to_ms,
+                         track_point **out) {
+  std::vector<ns3::TrackStore::Point> points;
+  store->store.QueryTimeRange(object, from_ms, to_ms, points);
+  std::vector<track_point> converted;
+  converted.reserve(points.size());
+  for (const ns3::TrackStore::Point &p : points) {
+    converted.push_back(ToC(p));
+  }
+  *out = Copy(converted);
+  return converted.size();
+}
+
+size_t track_store_box(const track_store *store, double min_lat, double min_lon, double max_lat,
+                       double max_lon, int64_t from_ms, int64_t to_ms, int64_t **objects,
+                       track_point **out) {
+  std::vector<int64_t> ids;
+  std::vector<track_point> points;
+  store->store.QueryBox(min_lon, min_lat, max_lon, max_lat, from_ms, to_ms,
+                        [&](uint64_t object, const ns3::TrackStore::Point &p) {
+                          ids.push_back(static_cast<int64_t>(object));
+                          points.push_back(ToC(p));
+                        });
+  *objects = Copy(ids);
+  *out = Copy(points);
+  return points.size();
+}
+
+size_t track_store_size(const track_store *store) { return store->store.GetSize(); }
+
+}
@@ -0,0 +1,151 @@
+package main
+
+/*
+#cgo CXXFLAGS: -std=c++17 -O2 -I${SRCDIR}/../sim
+#cgo LDFLAGS: -lstdc++
+#include <stdlib.h>
+#include "trackstore.h"
+*/
+import "C"
+
+import (
+	"math"
+	"sync"
+	"time"
+	"unsafe"
+)
+
+// TrackStore guarda os históricos sincronizados no armazenamento C++ de
+// sim/track_store.h, em blocos colunares comprimidos e indexados por tempo e
+// por área. Consultas podem rodar em paralelo; sincronizações são exclusivas.
+type TrackStore struct {
+	mu  sync.RWMutex
+	ptr *C.track_store
+}
+
+func NewTrackStore() *TrackStore {
+	return &TrackStore{ptr: C.track_store_new()}
+}
+
+func (s *TrackStore) Close() {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	C.track_store_free(s.ptr)
+	s.ptr = nil
+}
+
+// Sync adiciona um lote de pontos de um objeto; a ordem de chegada não importa.
+func (s *TrackStore) Sync(id int64, trackInfo []TrackInfo) {
+	if len(trackInfo) == 0 {
+		return
+	}
+
+	points := make([]C.track_point, len(trackInfo))
+	for i, t := range trackInfo {
+		points[i] = C.track_point{
+			time_ms: C.int64_t(t.Time.UnixMilli()),
+			lat:     C.double(t.Lat),
+			lon:     C.double(t.Lon),
+		}
+	}
+
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	C.track_store_append(s.ptr, C.int64_t(id), &points[0], C.size_t(len(points)))
+}
+
+// LastLocation retorna o ponto mais recente (pelo horário da coleta) do objeto.
+func (s *TrackStore) LastLocation(id int64) (TrackInfo, bool) {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+
+	var p C.track_point
+	if C.track_store_last(s.ptr, C.int64_t(id), &p) == 0 {
+		return TrackInfo{}, false
+	}
+
+	return fromC(p), true
+}
+
+// History retorna os pontos do objeto com from <= Time < to, em ordem cronológica.
+func (s *TrackStore) History(id int64, from, to time.Time) []TrackInfo {
+	return s.history(id, from.UnixMilli(), to.UnixMilli())
+}
+
+func (s *TrackStore) history(id int64, fromMs, toMs int64) []TrackInfo {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+
+	var out *C.track_point
+	n := C.track_store_range(s.ptr, C.int64_t(id), C.int64_t(fromMs), C.int64_t(toMs), &out)
+	defer C.free(unsafe.Pointer(out))
+
+	trackInfo := make([]TrackInfo, n)
+	for i, p := range unsafe.Slice(out, n) {
+		trackInfo[i] = fromC(p)
+	}
+
+	return trackInfo
+}
+
+// InArea retorna, por objeto, os pontos dentro do retângulo no intervalo [from, to).
+func (s *TrackStore) InArea(minLat, minLon, maxLat, maxLon float64, from, to time.Time) map[int64][]TrackInfo {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+
+	var objects *C.int64_t
+	var out *C.track_point
+	n := C.track_store_box(s.ptr, C.double(minLat), C.double(minLon), C.double(maxLat), C.double(maxLon),
+		C.int64_t(from.UnixMilli()), C.int64_t(to.UnixMilli()), &objects, &out)
+	defer C.free(unsafe.Pointer(objects))
+	defer C.free(unsafe.Pointer(out))
+
+	result := make(map[int64][]TrackInfo)
+	ids := unsafe.Slice(objects, n)
+	for i, p := range unsafe.Slice(out, n) {
+		id := int64(ids[i])
+		result[id] = append(result[id], fromC(p))
+	}
+
+	return result
+}
+
+func (s *TrackStore) Size() int {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+
+	return int(C.track_store_size(s.ptr))
+}
+
+func fromC(p C.track_point) TrackInfo {
+	return TrackInfo{
+		Time: time.UnixMilli(int64(p.time_ms)),
+		Lat:  float64(p.lat),
+		Lon:  float64(p.lon),
+	}
+}
+
+// StoredObject é um Trackeable cujo histórico fica no TrackStore.
+type StoredObject struct {
+	ID    int64
+	store *TrackStore
+}
+
+func (s *TrackStore) Object(id int64) *StoredObject {
+	return &StoredObject{ID: id, store: s}
+}
+
+func (o *StoredObject) SyncTrackingHistory(trackInfo []TrackInfo) {
+	o.store.Sync(o.ID, trackInfo)
+}
+
+func (o *StoredObject) GetLastLocation() TrackInfo {
+	trackInfo, _ := o.store.LastLocation(o.ID)
+	return trackInfo
+}
+
+func (o *StoredObject) GetTrackingHistory() []TrackInfo {
+	return o.store.history(o.ID, math.MinInt64, math.MaxInt64)
+}
@@ -0,0 +1,40 @@
+#ifndef WEB_TRACKSTORE_H
+#define WEB_TRACKSTORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Interface C do TrackStore (sim/track_store.h) para uso via cgo.
+
+typedef struct track_store track_store;
+
+typedef struct {
+  int64_t time_ms;
+  double lat;
+  double lon;
+} track_point;
+
+track_store *track_store_new(void);
+void track_store_free(track_store *store);
+
+void track_store_append(track_store *store, int64_t object, const track_point *points, size_t n);
+int track_store_last(const track_store *store, int64_t object, track_point *out);
+
+// Os vetores de saída são alocados com malloc e devem ser liberados com free.
+size_t track_store_range(const track_store *store, int64_t object, int64_t from_ms, int64_t to_ms,
+                         track_point **out);
+size_t track_store_box(const track_store *store, double min_lat, double min_lon, double max_lat,
+                       double max_lon, int64_t from_ms, int64_t to_ms, int64_t **objects,
+                       track_point **out);
+
+size_t track_store_size(const track_store *store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WEB_TRACKSTORE_H */